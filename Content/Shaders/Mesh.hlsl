@@ -2,6 +2,7 @@ struct PS_INPUT
 {
     float4 pos : SV_POSITION;
     float3 normal : NORMAL;
+    nointerpolation float3 color : COLOR;
 };
 
 #ifdef _VS
@@ -16,20 +17,53 @@ cbuffer transformBuf : register(b1)
     row_major float4x4 TransformMatrix;
 };
 
+// Must match VoxelSize and PackedVoxelVertex in Voxel/
+static const float VoxelSize = 1.0f;
+static const float VoxelExtent = VoxelSize * 0.5f;
+static const uint PositionBits = 7;
+static const uint PositionMask = (1u << PositionBits) - 1u;
+static const uint MaterialShift = 24;
+
+// Indexed by FaceDir
+static const float3 FaceNormals[6] =
+{
+    float3(-1,  0,  0),
+    float3( 1,  0,  0),
+    float3( 0, -1,  0),
+    float3( 0,  1,  0),
+    float3( 0,  0, -1),
+    float3( 0,  0,  1),
+};
+
+// Indexed by VoxelMaterial
+static const float3 MaterialColors[4] =
+{
+    float3(1.0, 0.0, 1.0),
+    float3(0.5, 0.5, 0.5),
+    float3(0.45, 0.3, 0.15),
+    float3(0.3, 0.6, 0.2),
+};
+
 struct VS_INPUT
 {
-    float3 pos : POSITION;
-    float3 normal : NORMAL;
+    uint packed : PACKED;
 };
 
 PS_INPUT main(VS_INPUT input)
 {
     PS_INPUT output;
 
-    float4 worldPos = mul(TransformMatrix, float4(input.pos.xyz, 1.f));
+    uint3 corner = uint3(input.packed, input.packed >> PositionBits, input.packed >> (PositionBits * 2)) & PositionMask;
+    uint face = (input.packed >> (PositionBits * 3)) & 0x7;
+    uint material = input.packed >> MaterialShift;
+
+    float3 pos = float3(corner) * VoxelSize - VoxelExtent;
+
+    float4 worldPos = mul(TransformMatrix, float4(pos, 1.f));
 
     output.pos = mul( ViewProjectionMatrix, worldPos);
-    output.normal = normalize(mul(TransformMatrix, float4(input.normal, 0.0f)));
+    output.normal = normalize(mul(TransformMatrix, float4(FaceNormals[face], 0.0f)));
+    output.color = MaterialColors[min(material, 3u)];
     return output;
 };
 
@@ -45,7 +79,7 @@ float4 main(PS_INPUT input) : SV_Target0
 
     float ndl = saturate(dot(n, -l));
 
-    return float4((ndl * 0.8 + 0.1).rrr, 1); 
+    return float4((ndl * 0.8 + 0.1) * input.color, 1); 
 };
 
 #endif
\ No newline at end of file
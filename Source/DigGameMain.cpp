@@ -5,6 +5,7 @@
 
 #include "Render/Render.h"
 #include "Surf/HighResolutionClock.h"
+#include "Surf/JobSystem.h"
 #include "Surf/KeyCodes.h"
 #include "Surf/SurfMath.h"
 
@@ -13,9 +14,11 @@
 #include "ThirdParty/imgui/examples/imgui_impl_win32.h"
 #include "ThirdParty/FastNoiseLite/FastNoistLite.h"
 #include "ImGui/imgui_impl_render.h"
-
-#include <bitset>
-#include <unordered_map>
+#include "Voxel/ChunkMeshScheduler.h"
+#include "Voxel/ChunkResidency.h"
+#include "Voxel/ChunkStreamer.h"
+#include "Voxel/TerrainPipeline.h"
+#include "Voxel/VoxelWorld.h"
 
 struct
 {
@@ -38,230 +41,11 @@ struct
 	matrix view;
 } viewData;
 
-enum class MeshBuffer : u8
-{
-	POSITION,
-	NORMAL,
-	COUNT,
-};
-
-struct Mesh
-{
-	VertexBuffer_t vertexBufs[(u8)MeshBuffer::COUNT] = {VertexBuffer_t::INVALID};
-	IndexBuffer_t indexBuf = IndexBuffer_t::INVALID;
-	RenderFormat indexType = RenderFormat::UNKNOWN;
-	u32 indexCount = 0;
-	u32 strides[(u8)MeshBuffer::COUNT] = {0};
-	u32 offsets[(u8)MeshBuffer::COUNT] = {0};
-};
-
 struct MeshMaterial
 {
 	GraphicsPipelineState_t pso;
 };
 
-static Mesh CreateCubeMesh(float size)
-{
-	Mesh mesh;
-
-	std::vector<float3> normals;
-	normals.resize(6 * 4);
-
-	{
-		const float3 ftl = float3(-size, size, size);
-		const float3 ftr = float3(size, size, size);
-		const float3 fbr = float3(size, -size, size);
-		const float3 fbl = float3(-size, -size, size);
-
-		const float3 btl = float3(-size, size, -size);
-		const float3 btr = float3(size, size, -size);
-		const float3 bbr = float3(size, -size, -size);
-		const float3 bbl = float3(-size, -size, -size);
-
-		std::vector<float3> positions;
-		positions.resize(6 * 4);
-
-		auto it = positions.begin();
-
-		*it++ = { ftl }; *it++ = { ftr }; *it++ = { fbr }; *it++ = { fbl };
-		*it++ = { btr }; *it++ = { btl }; *it++ = { bbl }; *it++ = { bbr };
-		*it++ = { ftr }; *it++ = { btr }; *it++ = { bbr }; *it++ = { fbr };
-		*it++ = { btl }; *it++ = { ftl }; *it++ = { fbl }; *it++ = { bbl };
-		*it++ = { fbl }; *it++ = { fbr }; *it++ = { bbr }; *it++ = { bbl };
-		*it++ = { ftl }; *it++ = { btl }; *it++ = { btr }; *it++ = { ftr };
-
-		mesh.vertexBufs[(u8)MeshBuffer::POSITION] = CreateVertexBuffer(positions.data(), positions.size() * sizeof(float3));
-		mesh.strides[(u8)MeshBuffer::POSITION] = (u32)sizeof(float3);
-		mesh.offsets[(u8)MeshBuffer::POSITION] = 0u;
-	}
-
-	{
-		constexpr float3 front{ 0, 0, 1 };
-		constexpr float3 back{ 0, 0, -1 };
-		constexpr float3 left{ 1, 0, 0 };
-		constexpr float3 right{ -1, 0, 0 };
-		constexpr float3 bottom{ 0, -1, 0 };
-		constexpr float3 top{ 0, 1, 0 };
-
-		std::vector<float3> normals;
-		normals.resize(6 * 4);
-
-		auto it = normals.begin();
-
-		*it++ = front; *it++ = front; *it++ = front; *it++ = front;
-		*it++ = back; *it++ = back; *it++ = back; *it++ = back;
-		*it++ = left; *it++ = left; *it++ = left; *it++ = left;
-		*it++ = right; *it++ = right; *it++ = right; *it++ = right;
-		*it++ = bottom; *it++ = bottom; *it++ = bottom; *it++ = bottom;
-		*it++ = top; *it++ = top; *it++ = top; *it++ = top;
-
-		mesh.vertexBufs[(u8)MeshBuffer::NORMAL] = CreateVertexBuffer(normals.data(), normals.size() * sizeof(float3));
-		mesh.strides[(u8)MeshBuffer::NORMAL] = (u32)sizeof(float3);
-		mesh.offsets[(u8)MeshBuffer::NORMAL] = 0u;
-	}
-
-	std::vector<u16> indices;
-	indices.resize(6 * 6);
-
-	{
-		auto it = indices.begin();
-		for (u32 i = 0; i < 6 * 4; i += 4)
-		{
-			*it++ = i + 2; *it++ = i + 1; *it++ = i;
-			*it++ = i; *it++ = i + 3; *it++ = i + 2;
-		}
-	}
-
-	mesh.indexCount = (u32)indices.size();
-	mesh.indexBuf = CreateIndexBuffer(indices.data(), indices.size() * sizeof(u16));
-	mesh.indexType = RenderFormat::R16_UINT;
-
-	return mesh;
-}
-
-constexpr float VoxelSize = 1.0f;
-constexpr float VoxelExtent = VoxelSize * 0.5f;
-
-struct Chunk
-{
-	static const size_t dim = 16;
-	std::bitset<dim * dim * dim> voxels;
-
-	Mesh mesh;
-
-	bool dirty = true;
-
-	static size_t Index(u32 x, u32 y, u32 z) { return (z * dim * dim) + (y * dim) + x; }
-	bool Empty(u32 x, u32 y, u32 z) const { return !voxels.test(Index(x, y, z)); }
-	void Set(u32 x, u32 y, u32 z) { voxels.set(Index(x, y, z), true); dirty = true;  }
-	void Remove(u32 x, u32 y, u32 z) { voxels.set(Index(x, y, z), false); dirty = true; }
-
-	void RebuildIfDirty()
-	{
-		if (!dirty)
-			return;
-
-		dirty = false;
-
-		constexpr float3 ftl = float3(-VoxelExtent, VoxelExtent, VoxelExtent);
-		constexpr float3 ftr = float3(VoxelExtent, VoxelExtent, VoxelExtent);
-		constexpr float3 fbr = float3(VoxelExtent, -VoxelExtent, VoxelExtent);
-		constexpr float3 fbl = float3(-VoxelExtent, -VoxelExtent, VoxelExtent);
-
-		constexpr float3 btl = float3(-VoxelExtent, VoxelExtent, -VoxelExtent);
-		constexpr float3 btr = float3(VoxelExtent, VoxelExtent, -VoxelExtent);
-		constexpr float3 bbr = float3(VoxelExtent, -VoxelExtent, -VoxelExtent);
-		constexpr float3 bbl = float3(-VoxelExtent, -VoxelExtent, -VoxelExtent);
-
-		constexpr float3 frontPositions[4] =	{ ftl, ftr, fbr, fbl };
-		constexpr float3 backPositions[4] =		{ btr, btl, bbl, bbr };
-		constexpr float3 leftPositions[4] =		{ ftr, btr, bbr, fbr };
-		constexpr float3 rightPositions[4] =	{ btl, ftl, fbl, bbl };
-		constexpr float3 bottomPositions[4] =	{ fbl, fbr, bbr, bbl };
-		constexpr float3 topPositions[4] =		{ ftl, btl, btr, ftr };
-
-		constexpr float3 frontNormal =	{  0,  0,  1 };
-		constexpr float3 backNormal =	{  0,  0, -1 };
-		constexpr float3 leftNormal =	{  1,  0,  0 };
-		constexpr float3 rightNormal =	{ -1,  0,  0 };
-		constexpr float3 bottomNormal = {  0, -1,  0 };
-		constexpr float3 topNormal =	{  0,  1,  0 };
-
-		for (u32 i = 0; i < (u32)MeshBuffer::COUNT; i++)
-		{
-			Render_Release(mesh.vertexBufs[i]);
-			mesh.vertexBufs[i] = VertexBuffer_t::INVALID;
-		}
-
-		Render_Release(mesh.indexBuf);
-		mesh.indexBuf = IndexBuffer_t::INVALID;
-
-		// This memory should be pre-alloced if we want efficiency, we know the theoretical max size
-		std::vector<float3> positions;
-		std::vector<float3> normals;
-		std::vector<u32> indices;
-
-		auto AddFace = [&](const float3 facePositions[4], const float3& faceNormal, u32 x, u32 y, u32 z)
-		{
-			for (u32 i = 0; i < 4; i++)
-			{
-				positions.push_back(facePositions[i] + float3{x, y, z} * VoxelSize);
-				normals.push_back(faceNormal);
-			}
-
-			const u32 vertexOffset = (u32)positions.size();
-			indices.push_back(vertexOffset + 2u);
-			indices.push_back(vertexOffset + 1u);
-			indices.push_back(vertexOffset);
-			indices.push_back(vertexOffset);
-			indices.push_back(vertexOffset + 3u);
-			indices.push_back(vertexOffset + 2u);
-		};
-
-		for (u32 z = 0; z < dim; z++)
-		{
-			for (u32 y = 0; y < dim; y++)
-			{
-				for (u32 x = 0; x < dim; x++)
-				{
-					if (Empty(x, y, z))
-						continue;
-
-					if (z <= 0 || Empty(x, y, z - 1))
-						AddFace(backPositions, backNormal, x, y, z);
-
-					if (z >= (dim - 1) || Empty(x, y, z + 1))
-						AddFace(frontPositions, frontNormal, x, y, z);
-
-					if (x <= 0 || Empty(x - 1, y, z))
-						AddFace(rightPositions, rightNormal, x, y, z);
-
-					if (x >= (dim - 1) || Empty(x + 1, y, z))
-						AddFace(leftPositions, leftNormal, x, y, z);
-
-					if (y <= 0 || Empty(x, y - 1, z))
-						AddFace(bottomPositions, bottomNormal, x, y, z);
-
-					if (y >= (dim - 1) || Empty(x, y + 1, z))
-						AddFace(topPositions, topNormal, x, y, z);
-				}
-			}
-		}
-
-		mesh.vertexBufs[(u8)MeshBuffer::POSITION] = CreateVertexBuffer(positions.data(), positions.size() * sizeof(float3));
-		mesh.strides[(u8)MeshBuffer::POSITION] = (u32)sizeof(float3);
-		mesh.offsets[(u8)MeshBuffer::POSITION] = 0u;
-
-		mesh.vertexBufs[(u8)MeshBuffer::NORMAL] = CreateVertexBuffer(normals.data(), normals.size() * sizeof(float3));
-		mesh.strides[(u8)MeshBuffer::NORMAL] = (u32)sizeof(float3);
-		mesh.offsets[(u8)MeshBuffer::NORMAL] = 0u;
-
-		mesh.indexCount = (u32)indices.size();
-		mesh.indexBuf = CreateIndexBuffer(indices.data(), indices.size() * sizeof(u32));
-		mesh.indexType = RenderFormat::R32_UINT;
-	}
-};
-
 static void ResizeTargets(u32 w, u32 h)
 {
 	w = Max(w, 1u);
@@ -325,10 +109,10 @@ static MeshMaterial CreateMaterial()
 	desc.vs = CreateVertexShader(shaderPath);
 	desc.ps = CreatePixelShader(shaderPath);
 
+	// Chunk vertices are a single PackedVoxelVertex, decoded in the vertex shader.
 	InputElementDesc inputDesc[] =
 	{
-		{"POSITION", 0, RenderFormat::R32G32B32_FLOAT, 0, 0, InputClassification::PerVertex, 0 },
-		{"NORMAL", 0, RenderFormat::R32G32B32_FLOAT, 1, 0, InputClassification::PerVertex, 0 },
+		{"PACKED", 0, RenderFormat::R32_UINT, 0, 0, InputClassification::PerVertex, 0 },
 	};
 
 	MeshMaterial mat;
@@ -337,93 +121,10 @@ static MeshMaterial CreateMaterial()
 	return mat;
 }
 
-#define VOXELS_PER_CHUNK 4u
-#define VOXEL_MASK ((1u << (VOXELS_PER_CHUNK)) - 1u)
-#define CHUNK_MASK (~VOXEL_MASK)
-
-struct VoxelCoord
-{
-	union
-	{
-		struct
-		{
-			u32 blockX : 4;
-			u32 chunkX : 28;
-		};
-		u32 x;
-	};
+// Voxel coordinates are unsigned, so start well inside the world to leave room to stream out in every direction.
+constexpr float k_SpawnCoord = 16384.0f;
 
-	union
-	{
-		struct
-		{
-			u32 blockY : 4;
-			u32 chunkY : 28;
-		};
-		u32 y;
-	};
-
-	union
-	{
-		struct
-		{
-			u32 blockZ : 4;
-			u32 chunkZ : 28;
-		};
-		u32 z;
-	};
-
-	VoxelCoord(u32 _x, u32 _y, u32 _z) : x(_x), y(_y), z(_z) {}
-};
-
-struct ChunkCoord
-{
-	VoxelCoord coord;
-	ChunkCoord(const VoxelCoord& _coord) : coord(_coord.x & CHUNK_MASK, _coord.y & CHUNK_MASK, _coord.z & CHUNK_MASK) {}
-	ChunkCoord(u32 _x, u32 _y, u32 _z) : coord(_x & CHUNK_MASK, _y & CHUNK_MASK, _z & CHUNK_MASK) {}
-
-	bool operator==(const ChunkCoord& other) const { return coord.chunkX == other.coord.chunkX && coord.chunkY == other.coord.chunkY && coord.chunkZ == other.coord.chunkZ; }
-};
-
-template<>
-struct std::hash<ChunkCoord>
-{
-	std::size_t operator()(const ChunkCoord& s) const noexcept
-	{
-		return ((size_t)(s.coord.x & 0x1FFFFF) << 42) | ((size_t)(s.coord.y & 0x1FFFFF) << 21) | (size_t)(s.coord.z & 0x1FFFFF);
-	}
-};
-
-struct VoxelWorld
-{
-	std::unordered_map<ChunkCoord, Chunk> chunks;
-	
-	Chunk& GetChunk(VoxelCoord coord)
-	{
-		ChunkCoord cc{ coord };
-		return chunks[cc];
-	}
-
-	void AddVoxel(VoxelCoord coord)
-	{
-		GetChunk(coord).Set(coord.blockX, coord.blockY, coord.blockZ);
-	}
-
-	void AddVoxel(u32 x, u32 y, u32 z)
-	{
-		AddVoxel(VoxelCoord{ x, y, z });
-	}
-
-	void RemoveVoxel(VoxelCoord coord)
-	{
-		GetChunk(coord).Remove(coord.blockX, coord.blockY, coord.blockZ);
-	}
-
-	void RemoveVoxel(u32 x, u32 y, u32 z)
-	{
-		RemoveVoxel(VoxelCoord{ x, y, z });
-	}
-};
+static const VoxelLayer k_TerrainLayers[] = { { 1, VoxelMaterial_Grass }, { 3, VoxelMaterial_Dirt }, { 0, VoxelMaterial_Stone } };
 
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -460,40 +161,50 @@ int main()
 
 	HighResolutionClock updateClock;
 
-	UpdateView(float3{ -2, 6, -2 }, 0.0f, 45.0f);
+	UpdateView(float3{ k_SpawnCoord, 40.0f, k_SpawnCoord }, 0.0f, 45.0f);
 
 	// Set up entities
 	MeshMaterial material = CreateMaterial();
+	ChunkQuadIndices_Init();
 
 	FastNoiseLite noise;
 	noise.SetNoiseType(FastNoiseLite::NoiseType_OpenSimplex2);
 
+	JobSystem jobs;
+
 	VoxelWorld world;
 
-	for (u32 y = 0; y < 512; y++)
-	{
-		for (u32 x = 0; x < 512; x++)
-		{
-			const float n = (noise.GetNoise((float)x, (float)y) + 1.0f) * 0.5f;
-			const u32 height = (u32)(n * 32);
-			for (u32 h = 0; h < height; h++)
-			{
-				world.AddVoxel(x, h, y);
-			}
-		}
-	}
+	// Noise sampled every 4 voxels and interpolated in between, 64 times fewer noise calls than sampling every voxel.
+	VoxelDensity caves;
+	caves.noise = &noise;
+	caves.scale = 4.0f;
+	caves.cellSize = 4;
+	caves.threshold = 0.6f;
+
+	TerrainPipeline terrain;
+	terrain.AddStage(MakeHeightmapStage(noise, 0.0f, 32.0f));
+	terrain.AddStage(MakeCarveStage(caves));
+	terrain.AddStage(MakeSurfaceStage(k_TerrainLayers, ARRAYSIZE(k_TerrainLayers)));
+	terrain.AddStage(MakeBoulderStage(1337, 2, 0.25f, 3));
+	std::vector<TerrainStageStats> terrainStats;
 
-	//for (u32 y = 0; y < 256; y++)
-	//{
-	//	for (u32 x = 0; x < 256; x++)
-	//	{
-	//		for (u32 z = 0; z < 128; z++)
-	//		{
-	//			if (noise.GetNoise((float)x * 4, (float)y * 4, (float)z * 4) > 0.0f)
-	//				world.AddVoxel(x, z, y);
-	//		}
-	//	}
-	//}
+	// Nothing is edited yet, so unloaded columns and evicted chunks are simply regenerated.
+	ChunkStreamer streamer;
+	StreamingStats streamingStats;
+
+	ChunkResidency residency;
+	ResidencyStats residencyStats;
+
+	streamer.forgetChunk = [&residency](const ChunkCoord& cc) { residency.Forget(cc); };
+
+	streamer.generateColumn = [&terrain](VoxelColumn& column) { terrain.GenerateColumn(column); };
+	residency.loadChunk = [&terrain](const ChunkCoord& cc, ChunkVoxels& voxels) { terrain.GenerateChunk(cc, voxels); };
+
+	ChunkMeshScheduler meshScheduler;
+	MeshingMode meshingMode = MeshingMode::Binary;
+	MeshingStats lastMeshingStats;
+	MeshingStats frameMeshingStats;
+	size_t drawnQuadCount = 0;
 
 	// Main loop
 	bool bQuit = false;
@@ -512,8 +223,14 @@ int main()
 
 		float delta = (float)updateClock.GetDeltaSeconds();
 
-		for (auto& chunkIt : world.chunks)
-			chunkIt.second.RebuildIfDirty();
+		streamer.Update(world, jobs, viewData.position, viewData.lookDir, &streamingStats);
+		residency.Update(world, jobs, viewData.position, &residencyStats);
+
+		frameMeshingStats = MeshingStats();
+		meshScheduler.Update(world, jobs, viewData.position, viewData.lookDir, meshingMode, &frameMeshingStats);
+
+		if (frameMeshingStats.chunksRebuilt)
+			lastMeshingStats = frameMeshingStats;
 
 		// ImGui stuff
 		ImGui_ImplRender_NewFrame();
@@ -521,6 +238,82 @@ int main()
 
 		ImGui::NewFrame();
 		ImGui::ShowDemoWindow();
+
+		if (ImGui::Begin("World"))
+		{
+			if (ImGui::BeginCombo("Meshing", MeshingModeName(meshingMode)))
+			{
+				for (u8 i = 0; i < (u8)MeshingMode::COUNT; i++)
+				{
+					if (ImGui::Selectable(MeshingModeName((MeshingMode)i), meshingMode == (MeshingMode)i) && meshingMode != (MeshingMode)i)
+					{
+						meshingMode = (MeshingMode)i;
+						world.MarkAllDirty();
+					}
+				}
+
+				ImGui::EndCombo();
+			}
+
+			size_t worldVertexCount = 0;
+			size_t worldQuadCount = 0;
+			for (const ChunkMap::Entry& entry : world.chunks)
+			{
+				worldVertexCount += entry.chunk.mesh.vertexCount;
+				worldQuadCount += entry.chunk.mesh.quadCount;
+			}
+
+			ImGui::Text("Chunks: %zu (%s layout)", world.chunks.size(), VOXEL_MORTON_LAYOUT ? "Morton" : "linear");
+			ImGui::Text("Vertices: %zu", worldVertexCount);
+			ImGui::Text("Quads: %zu", worldQuadCount);
+			ImGui::Text("Drawn Quads: %zu", drawnQuadCount);
+
+			VoxelRaycastHit lookHit;
+			if (world.Raycast(viewData.position, viewData.lookDir, 512.0f, lookHit))
+				ImGui::Text("Looking at: %u %u %u (%.1f away)", lookHit.x, lookHit.y, lookHit.z, lookHit.distance);
+			else
+				ImGui::Text("Looking at: nothing");
+
+			ImGui::Separator();
+			ImGui::SliderFloat("Upload Budget (ms)", &meshScheduler.uploadBudgetMs, 0.1f, 16.0f);
+			ImGui::SliderInt("Max Jobs In Flight", (int*)&meshScheduler.maxJobsInFlight, 1, 512);
+			ImGui::Text("In flight: %u Waiting: %u", frameMeshingStats.chunksInFlight, frameMeshingStats.chunksWaiting);
+
+			ImGui::Separator();
+			ImGui::SliderFloat("View Radius", &streamer.viewRadius, 16.0f, 2048.0f);
+			ImGui::SliderInt("Max Columns In Flight", (int*)&streamer.maxJobsInFlight, 1, 64);
+			ImGui::Text("Columns: %u In flight: %u Waiting: %u", streamingStats.loadedColumns, streamingStats.columnsInFlight, streamingStats.columnsWaiting);
+
+			ImGui::Separator();
+			terrain.GetStats(terrainStats);
+			for (const TerrainStageStats& stage : terrainStats)
+			{
+				const double usPerChunk = stage.chunks ? stage.milliseconds * 1000.0 / stage.chunks : 0.0;
+				ImGui::Text("%-10s %8.1fms %6llu chunks %5.1fus/chunk %10llu voxels", stage.name, stage.milliseconds,
+					(unsigned long long)stage.chunks, usPerChunk, (unsigned long long)stage.voxels);
+			}
+			if (ImGui::Button("Reset Generation Stats"))
+				terrain.ResetStats();
+
+			ImGui::Separator();
+			float cpuBudgetMb = (float)residency.cpuBudgetBytes / (1024.0f * 1024.0f);
+			float gpuBudgetMb = (float)residency.gpuBudgetBytes / (1024.0f * 1024.0f);
+			if (ImGui::SliderFloat("CPU Budget (MB)", &cpuBudgetMb, 1.0f, 4096.0f))
+				residency.cpuBudgetBytes = (size_t)(cpuBudgetMb * 1024.0f * 1024.0f);
+			if (ImGui::SliderFloat("VRAM Budget (MB)", &gpuBudgetMb, 1.0f, 4096.0f))
+				residency.gpuBudgetBytes = (size_t)(gpuBudgetMb * 1024.0f * 1024.0f);
+			ImGui::SliderFloat("Resident Distance", &residency.residentDistance, 16.0f, 2048.0f);
+			ImGui::Text("CPU: %.1fMB VRAM: %.1fMB", residencyStats.cpuBytes / (1024.0 * 1024.0), residencyStats.gpuBytes / (1024.0 * 1024.0));
+			ImGui::Text("Resident: %u Evicted: %u Loading: %u", residencyStats.residentChunks, residencyStats.evictedChunks, residencyStats.chunksLoading);
+
+			ImGui::Separator();
+			ImGui::Text("Last rebuild: %u chunks on %u threads", lastMeshingStats.chunksRebuilt, lastMeshingStats.meshingThreads);
+			ImGui::Text("Mesh: %.3fms", lastMeshingStats.meshMilliseconds);
+			ImGui::Text("Upload: %.3fms", lastMeshingStats.uploadMilliseconds);
+			ImGui::Text("Vertices: %zu Quads: %zu", lastMeshingStats.vertexCount, lastMeshingStats.quadCount);
+		}
+		ImGui::End();
+
 		ImGui::Render();
 
 		ImGuiIO& io = ImGui::GetIO();
@@ -610,21 +403,55 @@ int main()
 
 		// Prepare to draw mesh
 		cl->SetPipelineState(material.pso);
+		cl->SetIndexBuffer(ChunkQuadIndices_Buffer(), ChunkQuadIndices_Format(), 0);
 
-		for (const auto& chunkIt : world.chunks)
+		drawnQuadCount = 0;
+
+		for (ChunkMap::Entry& entry : world.chunks)
 		{
-			const Mesh& mesh = chunkIt.second.mesh;
+			const Mesh& mesh = entry.chunk.mesh;
+
+			if (mesh.quadCount == 0)
+				continue;
 
-			cl->SetVertexBuffers(0, (u32)MeshBuffer::COUNT, mesh.vertexBufs, mesh.strides, mesh.offsets);
-			cl->SetIndexBuffer(mesh.indexBuf, mesh.indexType, 0);
+			const float3 chunkPos = float3(entry.coord.coord.x, entry.coord.coord.y, entry.coord.coord.z) * VoxelSize;
+			const float3 boundsMin = chunkPos - float3(VoxelExtent);
+			const float3 boundsMax = boundsMin + float3(Chunk::dim * VoxelSize);
 
-			matrix transform = MakeMatrixTranslation(float3(chunkIt.first.coord.x, chunkIt.first.coord.y, chunkIt.first.coord.z));
+			const u32 visibleFaces = ChunkVisibleFaces(boundsMin, boundsMax, viewData.position);
+
+			cl->SetVertexBuffers(0, 1, &mesh.vertexBuf, &mesh.stride, &mesh.offset);
+
+			matrix transform = MakeMatrixTranslation(chunkPos);
 
 			DynamicBuffer_t transformBuf = CreateDynamicConstantBuffer(&transform, sizeof(transform));
 
 			cl->BindVertexCBVs(1, 1, &transformBuf);
 
-			cl->DrawIndexedInstanced(mesh.indexCount, 1, 0, 0, 0);
+			auto Drawn = [&](u32 dir) { return (visibleFaces & (1u << dir)) != 0 && mesh.FaceQuadCount((FaceDir)dir) > 0; };
+
+			const size_t drawnBefore = drawnQuadCount;
+
+			// Directions are laid out one after another, so runs of visible directions draw together.
+			for (u32 dir = 0; dir < FaceDir_Count; )
+			{
+				if (!Drawn(dir))
+				{
+					dir++;
+					continue;
+				}
+
+				const u32 firstQuad = mesh.FaceFirstQuad((FaceDir)dir);
+				u32 quadCount = 0;
+				for (; dir < FaceDir_Count && Drawn(dir); dir++)
+					quadCount += mesh.FaceDrawQuadCount((FaceDir)dir);
+
+				cl->DrawIndexedInstanced(quadCount * 6, 1, 0, firstQuad * 4, 0);
+				drawnQuadCount += quadCount;
+			}
+
+			if (drawnQuadCount > drawnBefore)
+				residency.MarkVisible(entry.chunk);
 		}
 
 		ImGui_ImplRender_RenderDrawData(ImGui::GetDrawData(), cl.get());
@@ -633,6 +460,11 @@ int main()
 		view->Present(true);
 	}
 
+	// Jobs still in flight write back into the mesh scheduler and streamer, let them finish before they go out of scope.
+	jobs.Wait();
+
+	ChunkQuadIndices_Release();
+
 	ImGui_ImplRender_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
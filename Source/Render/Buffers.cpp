@@ -69,12 +69,12 @@ ConstantBuffer_t CreateConstantBuffer(const void* const data, size_t size)
 	return newBuf;
 }
 
-void UpdateVertexBuffer(VertexBuffer_t vb, const void* const data, size_t size)
+void UpdateVertexBuffer(VertexBuffer_t vb, const void* const data, size_t size, size_t offset)
 {
 	if (BufferData* bufData = g_VertexBuffers.Get(vb))
 	{
-		assert(size <= bufData->size);
-		UpdateVertexBufferImpl(vb, data, size);
+		assert(offset + size <= bufData->size);
+		UpdateVertexBufferImpl(vb, data, size, offset);
 	}
 }
 
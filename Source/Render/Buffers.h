@@ -17,7 +17,8 @@ DynamicBuffer_t CreateDynamicVertexBuffer(const void* const data, size_t size);
 DynamicBuffer_t CreateDynamicIndexBuffer(const void* const data, size_t size);
 DynamicBuffer_t CreateDynamicConstantBuffer(const void* const data, size_t size);
 
-void UpdateVertexBuffer(VertexBuffer_t vb, const void* const data, size_t size);
+// Writes size bytes of data starting offset bytes into the buffer.
+void UpdateVertexBuffer(VertexBuffer_t vb, const void* const data, size_t size, size_t offset = 0);
 void UpdateIndexBuffer(IndexBuffer_t ib, const void* const data, size_t size);
 void UpdateConstantBuffer(ConstantBuffer_t cb, const void* const data, size_t size);
 
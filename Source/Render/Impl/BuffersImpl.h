@@ -7,7 +7,7 @@ bool CreateIndexBufferImpl(IndexBuffer_t handle, const void* const data, size_t
 bool CreateStructuredBufferImpl(StructuredBuffer_t handle, const void* data, size_t size, size_t stride, RenderResourceFlags flags);
 bool CreateConstantBufferImpl(ConstantBuffer_t handle, const void* const data, size_t size);
 
-void UpdateVertexBufferImpl(VertexBuffer_t vb, const void* const data, size_t size);
+void UpdateVertexBufferImpl(VertexBuffer_t vb, const void* const data, size_t size, size_t offset);
 void UpdateIndexBufferImpl(IndexBuffer_t ib, const void* const data, size_t size);
 void UpdateConstantBufferImpl(ConstantBuffer_t cb, const void* const data, size_t size);
 
@@ -62,7 +62,7 @@ bool CreateBuffer(const void* const data, UINT size, D3D11_USAGE usage, UINT bin
 	return SUCCEEDED(g_render.device->CreateBuffer(&desc, data ? &subRes : nullptr, &buffer));
 }
 
-static bool CopyToBuffer(ID3D11Buffer* target, const void* const data, UINT size)
+static bool CopyToBuffer(ID3D11Buffer* target, const void* const data, UINT size, UINT offset = 0)
 {
 	if (!target)
 		return false;
@@ -82,7 +82,7 @@ static bool CopyToBuffer(ID3D11Buffer* target, const void* const data, UINT size
 	if (FAILED(g_render.device->CreateBuffer(&desc, data ? &subRes : nullptr, &staging)))
 		return false;
 
-	g_render.context->CopySubresourceRegion(target, 0, 0, 0, 0, staging.Get(), 0, nullptr);
+	g_render.context->CopySubresourceRegion(target, 0, offset, 0, 0, staging.Get(), 0, nullptr);
 
 	return true;
 }
@@ -107,9 +107,9 @@ bool CreateConstantBufferImpl(ConstantBuffer_t handle, const void* const data, s
 	return CreateBuffer(data, (UINT)size, D3D11_USAGE_DYNAMIC, D3D11_BIND_CONSTANT_BUFFER, 0, 0, AllocConstantBuffer(handle));
 }
 
-void UpdateVertexBufferImpl(VertexBuffer_t vb, const void* const data, size_t size)
+void UpdateVertexBufferImpl(VertexBuffer_t vb, const void* const data, size_t size, size_t offset)
 {
-	CopyToBuffer(g_DxVertexBuffers[(uint32_t)vb].Get(), data, (UINT)size);
+	CopyToBuffer(g_DxVertexBuffers[(uint32_t)vb].Get(), data, (UINT)size, (UINT)offset);
 }
 
 void UpdateIndexBufferImpl(IndexBuffer_t ib, const void* const data, size_t size)
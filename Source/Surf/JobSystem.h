@@ -0,0 +1,106 @@
+/**
+ * Fixed pool of worker threads pulling jobs from a shared queue.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+    // Passing zero workers creates one per hardware thread, leaving one free for the main thread.
+    explicit JobSystem(uint32_t numWorkers = 0)
+    {
+        if (numWorkers == 0)
+        {
+            const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        m_Workers.reserve(numWorkers);
+        for (uint32_t i = 0; i < numWorkers; i++)
+            m_Workers.emplace_back([this] { WorkerLoop(); });
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Quit = true;
+        }
+
+        m_JobAvailable.notify_all();
+
+        for (std::thread& worker : m_Workers)
+            worker.join();
+    }
+
+    uint32_t GetWorkerCount() const { return (uint32_t)m_Workers.size(); }
+
+    // Queue a job to run on any worker.
+    void Submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.push_back(std::move(job));
+            m_Pending++;
+        }
+
+        m_JobAvailable.notify_one();
+    }
+
+    // Block until every submitted job has finished.
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Idle.wait(lock, [this] { return m_Pending == 0; });
+    }
+
+private:
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_JobAvailable.wait(lock, [this] { return m_Quit || !m_Jobs.empty(); });
+
+                if (m_Jobs.empty())
+                    return;
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (--m_Pending == 0)
+                    m_Idle.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_Workers;
+    std::deque<std::function<void()>> m_Jobs;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAvailable;
+    std::condition_variable m_Idle;
+
+    uint32_t m_Pending = 0;
+    bool m_Quit = false;
+};
@@ -3,6 +3,12 @@
 #include <assert.h>
 #include <memory>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+typedef uint64_t u64;
+typedef int64_t i64;
 typedef uint32_t u32;
 typedef int32_t i32;
 typedef uint16_t u16;
@@ -546,6 +552,27 @@ inline u32 FloorLog2(u32 n) noexcept
     return ret;
 }
 
+// Bits
+// Returns 64 when no bits are set.
+inline u32 CountTrailingZeros64(u64 n) noexcept
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    return _BitScanForward64(&index, n) ? (u32)index : 64u;
+#else
+    return n ? (u32)__builtin_ctzll(n) : 64u;
+#endif
+}
+
+inline u32 PopCount64(u64 n) noexcept
+{
+#ifdef _MSC_VER
+    return (u32)__popcnt64(n);
+#else
+    return (u32)__builtin_popcountll(n);
+#endif
+}
+
 // Vector
 inline constexpr float3 MultiplyAddF3(float3 a, float3 b, float3 c) noexcept
 {
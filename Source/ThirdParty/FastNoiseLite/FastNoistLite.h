@@ -394,6 +394,9 @@ public:
 	}
 
 private:
+	// Reads the settings and lookup tables to evaluate many positions at once.
+	friend struct NoiseBatch;
+
 	template <typename T>
 	struct Arguments_must_be_floating_point_values;
 
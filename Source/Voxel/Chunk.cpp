@@ -0,0 +1,600 @@
+#include "Chunk.h"
+
+#include "ChunkMesher.h"
+
+#include <algorithm>
+
+constexpr ChunkVoxels::Row ChunkVoxels::FullRow;
+
+static constexpr size_t k_ChunkVoxelCount = ChunkVoxels::dim * ChunkVoxels::dim * ChunkVoxels::dim;
+
+// Index widths are powers of two so an index never straddles two words.
+static u32 PaletteIndexBits(size_t paletteSize)
+{
+	if (paletteSize <= 2)
+		return 0;
+	if (paletteSize <= 4)
+		return 2;
+	if (paletteSize <= 16)
+		return 4;
+	return 8;
+}
+
+// Writes paletteIndex for the voxels of row in mask. The indices of a row are a whole number of words, or an aligned
+// part of one, so they are written a word at a time.
+static void WriteRowIndices(u64* words, u32 indexBits, size_t row, ChunkVoxels::Row mask, u32 paletteIndex)
+{
+	constexpr u32 dim = (u32)ChunkVoxels::dim;
+
+	const u64 indexMask = (1ull << indexBits) - 1ull;
+	const u64 pattern = (u64)paletteIndex * (~0ull / indexMask);
+	const u32 voxelsPerWord = 64 / indexBits;
+
+	for (u32 x = 0; x < dim; x += voxelsPerWord)
+	{
+		const u32 count = Min(voxelsPerWord, dim - x);
+
+		u64 laneMask = 0;
+		for (u32 i = 0; i < count; i++)
+		{
+			if ((mask >> (x + i)) & 1u)
+				laneMask |= indexMask << (i * indexBits);
+		}
+
+		const size_t bit = (row * dim + x) * indexBits;
+		u64& word = words[bit / 64];
+		word = (word & ~(laneMask << (bit % 64))) | ((pattern & laneMask) << (bit % 64));
+	}
+}
+
+// Shared by every uniform chunk.
+static const std::vector<ChunkVoxels::Row> k_EmptyRows(ChunkVoxels::dim * ChunkVoxels::dim, (ChunkVoxels::Row)0);
+static const std::vector<ChunkVoxels::Row> k_FullRows(ChunkVoxels::dim * ChunkVoxels::dim, ChunkVoxels::FullRow);
+
+const ChunkVoxels::Row* ChunkVoxels::Rows() const
+{
+	if (!rows.empty())
+		return rows.data();
+
+	return uniformMaterial == VoxelMaterial_Air ? k_EmptyRows.data() : k_FullRows.data();
+}
+
+void ChunkVoxels::Set(u32 x, u32 y, u32 z, VoxelMaterial material)
+{
+	if (material == VoxelMaterial_Air)
+	{
+		Remove(x, y, z);
+		return;
+	}
+
+	if (IsUniform())
+	{
+		if (material == uniformMaterial)
+			return;
+
+		MakeMixed();
+	}
+
+	const u32 paletteIndex = FindOrAddPaletteEntry(material);
+
+	rows[RowIndex(y, z)] |= (Row)((Row)1 << x);
+
+	if (indexBits != 0)
+		SetPaletteIndex(VoxelIndex(x, y, z), paletteIndex);
+}
+
+void ChunkVoxels::Remove(u32 x, u32 y, u32 z)
+{
+	if (IsUniform())
+	{
+		if (uniformMaterial == VoxelMaterial_Air)
+			return;
+
+		MakeMixed();
+	}
+
+	rows[RowIndex(y, z)] &= (Row)~((Row)1 << x);
+
+	if (indexBits != 0)
+		SetPaletteIndex(VoxelIndex(x, y, z), 0);
+}
+
+void ChunkVoxels::GatherMaterialRows(u32 zBegin, u32 zEnd, Row* materialRows) const
+{
+	const size_t rowCount = dim * dim;
+
+	ForEachRowInSlices(zBegin, zEnd, [&](size_t row, u32, u32)
+	{
+		for (size_t entry = 0; entry < palette.size(); entry++)
+			materialRows[entry * rowCount + row] = 0;
+	});
+
+	if (indexBits == 0)
+	{
+		if (palette.size() > 1)
+		{
+			const Row* occupancy = Rows();
+			ForEachRowInSlices(zBegin, zEnd, [&](size_t row, u32, u32) { materialRows[rowCount + row] = occupancy[row]; });
+		}
+		return;
+	}
+
+	const u64 indexMask = (1ull << indexBits) - 1ull;
+
+	ForEachRowInSlices(zBegin, zEnd, [&](size_t row, u32, u32)
+	{
+		// Only solid voxels need their index looked at.
+		Row bits = rows[row];
+		while (bits)
+		{
+			const u32 x = CountTrailingZeros64(bits);
+			bits &= bits - 1;
+
+			const size_t bit = (row * dim + x) * indexBits;
+			const size_t entry = (size_t)((indices[bit / 64] >> (bit % 64)) & indexMask);
+			materialRows[entry * rowCount + row] |= (Row)((Row)1 << x);
+		}
+	});
+}
+
+u64 ChunkVoxels::BrickMask() const
+{
+	if (IsUniform())
+		return uniformMaterial == VoxelMaterial_Air ? 0ull : ~0ull;
+
+	constexpr Row brickRow = (Row)(((Row)1 << brickDim) - 1u);
+
+	u64 mask = 0;
+	ForEachRow([&](size_t row, u32 y, u32 z)
+	{
+		const Row bits = rows[row];
+		if (bits == 0)
+			return;
+
+		const u32 brickYZ = (u32)(y / brickDim) << 2 | (u32)(z / brickDim) << 4;
+		for (u32 bx = 0; bx < 4; bx++)
+		{
+			if (bits & (Row)(brickRow << (bx * brickDim)))
+				mask |= 1ull << (bx | brickYZ);
+		}
+	});
+	return mask;
+}
+
+void ChunkVoxels::Fill(VoxelMaterial material)
+{
+	std::vector<Row>().swap(rows);
+	std::vector<u64>().swap(indices);
+	indexBits = 0;
+
+	uniformMaterial = material;
+
+	palette.clear();
+	palette.push_back(VoxelMaterial_Air);
+	if (material != VoxelMaterial_Air)
+		palette.push_back(material);
+}
+
+void ChunkVoxels::FillRow(u32 y, u32 z, Row mask, VoxelMaterial material)
+{
+	if (mask == 0)
+		return;
+
+	if (IsUniform())
+	{
+		if (material == uniformMaterial)
+			return;
+
+		MakeMixed();
+	}
+
+	const size_t row = RowIndex(y, z);
+
+	u32 paletteIndex = 0;
+	if (material == VoxelMaterial_Air)
+	{
+		rows[row] &= (Row)~mask;
+	}
+	else
+	{
+		paletteIndex = FindOrAddPaletteEntry(material);
+		rows[row] |= mask;
+	}
+
+	if (indexBits != 0)
+		WriteRowIndices(indices.data(), indexBits, row, mask, paletteIndex);
+}
+
+void ChunkVoxels::FillBox(u32 minX, u32 minY, u32 minZ, u32 maxX, u32 maxY, u32 maxZ, VoxelMaterial material)
+{
+	if (minX >= maxX || minY >= maxY || minZ >= maxZ)
+		return;
+
+	if (minX == 0 && minY == 0 && minZ == 0 && maxX == dim && maxY == dim && maxZ == dim)
+	{
+		Fill(material);
+		return;
+	}
+
+	const u32 width = maxX - minX;
+	const Row mask = (Row)((width == dim ? ~0ull : (1ull << width) - 1ull) << minX);
+
+	for (u32 z = minZ; z < maxZ; z++)
+	{
+		for (u32 y = minY; y < maxY; y++)
+			FillRow(y, z, mask, material);
+	}
+}
+
+bool ChunkVoxels::Compact()
+{
+	if (IsUniform())
+		return false;
+
+	const Row first = rows[0];
+	if (first != 0 && first != FullRow)
+		return false;
+
+	for (Row row : rows)
+	{
+		if (row != first)
+			return false;
+	}
+
+	if (first == 0)
+	{
+		Fill(VoxelMaterial_Air);
+		return true;
+	}
+
+	// Full, but the voxels may still be made of different materials.
+	if (indexBits != 0)
+	{
+		const u64 entryMask = (1ull << indexBits) - 1ull;
+		const u32 entry = (u32)(indices[0] & entryMask);
+
+		u64 word = 0;
+		for (u32 bit = 0; bit < 64; bit += indexBits)
+			word |= (u64)entry << bit;
+
+		for (u64 packed : indices)
+		{
+			if (packed != word)
+				return false;
+		}
+
+		Fill(palette[entry]);
+		return true;
+	}
+
+	Fill(palette[1]);
+	return true;
+}
+
+void ChunkVoxels::MakeMixed()
+{
+	rows.assign(dim * dim, uniformMaterial == VoxelMaterial_Air ? (Row)0 : FullRow);
+}
+
+u32 ChunkVoxels::FindOrAddPaletteEntry(VoxelMaterial material)
+{
+	for (u32 i = 1; i < (u32)palette.size(); i++)
+	{
+		if (palette[i] == material)
+			return i;
+	}
+
+	palette.push_back(material);
+
+	const u32 newIndexBits = PaletteIndexBits(palette.size());
+	if (newIndexBits != indexBits)
+		Repack(newIndexBits);
+
+	return (u32)palette.size() - 1;
+}
+
+void ChunkVoxels::SetPaletteIndex(size_t voxelIndex, u32 paletteIndex)
+{
+	const size_t bit = voxelIndex * indexBits;
+	const u64 indexMask = (1ull << indexBits) - 1ull;
+
+	u64& word = indices[bit / 64];
+	word = (word & ~(indexMask << (bit % 64))) | ((u64)paletteIndex << (bit % 64));
+}
+
+void ChunkVoxels::Repack(u32 newIndexBits)
+{
+	assert(newIndexBits > indexBits);
+
+	std::vector<u64> newIndices(k_ChunkVoxelCount * newIndexBits / 64, 0ull);
+
+	for (size_t row = 0; row < dim * dim; row++)
+	{
+		// Without indices every solid voxel is entry one, so whole rows can be written at once.
+		if (indexBits == 0)
+		{
+			WriteRowIndices(newIndices.data(), newIndexBits, row, rows[row], 1);
+			continue;
+		}
+
+		for (u32 x = 0; x < dim; x++)
+		{
+			const size_t oldBit = (row * dim + x) * indexBits;
+			const size_t newBit = (row * dim + x) * newIndexBits;
+			const u64 index = (indices[oldBit / 64] >> (oldBit % 64)) & ((1ull << indexBits) - 1ull);
+			newIndices[newBit / 64] |= index << (newBit % 64);
+		}
+	}
+
+	indices.swap(newIndices);
+	indexBits = newIndexBits;
+}
+
+static IndexBuffer_t g_ChunkQuadIndexBuffer = IndexBuffer_t::INVALID;
+static RenderFormat g_ChunkQuadIndexFormat = RenderFormat::UNKNOWN;
+
+template<typename IndexType>
+static IndexBuffer_t CreateQuadIndexBuffer(u32 quadCount)
+{
+	std::vector<IndexType> indices;
+	indices.resize((size_t)quadCount * 6);
+
+	auto it = indices.begin();
+	for (u32 i = 0; i < quadCount * 4; i += 4)
+	{
+		*it++ = (IndexType)(i + 2); *it++ = (IndexType)(i + 1); *it++ = (IndexType)i;
+		*it++ = (IndexType)i; *it++ = (IndexType)(i + 3); *it++ = (IndexType)(i + 2);
+	}
+
+	return CreateIndexBuffer(indices.data(), indices.size() * sizeof(IndexType));
+}
+
+bool ChunkQuadIndices_Init()
+{
+	ChunkQuadIndices_Release();
+
+	if (k_MaxChunkQuads * 4 <= 0x10000u)
+	{
+		g_ChunkQuadIndexBuffer = CreateQuadIndexBuffer<u16>(k_MaxChunkQuads);
+		g_ChunkQuadIndexFormat = RenderFormat::R16_UINT;
+	}
+	else
+	{
+		g_ChunkQuadIndexBuffer = CreateQuadIndexBuffer<u32>(k_MaxChunkQuads);
+		g_ChunkQuadIndexFormat = RenderFormat::R32_UINT;
+	}
+
+	return g_ChunkQuadIndexBuffer != IndexBuffer_t::INVALID;
+}
+
+void ChunkQuadIndices_Release()
+{
+	Render_Release(g_ChunkQuadIndexBuffer);
+	g_ChunkQuadIndexBuffer = IndexBuffer_t::INVALID;
+	g_ChunkQuadIndexFormat = RenderFormat::UNKNOWN;
+}
+
+IndexBuffer_t ChunkQuadIndices_Buffer()
+{
+	return g_ChunkQuadIndexBuffer;
+}
+
+RenderFormat ChunkQuadIndices_Format()
+{
+	return g_ChunkQuadIndexFormat;
+}
+
+// Spare quads given to each range when the mesh is laid out, so most edits can be patched in place.
+static u32 RangeQuadCapacity(u32 quadCount)
+{
+	return quadCount + Max(quadCount / 4u, 8u);
+}
+
+void Chunk::GatherBorders(ChunkBorders& borders) const
+{
+	constexpr u32 last = (u32)dim - 1;
+
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		Row* plane = borders.planes[dir];
+
+		const Chunk* neighbour = neighbours[dir];
+		if (!neighbour)
+		{
+			for (u32 i = 0; i < dim; i++)
+				plane[i] = 0;
+			continue;
+		}
+
+		// The face of a uniform neighbour is all empty or all solid.
+		if (neighbour->voxels.IsUniform())
+		{
+			const Row fill = neighbour->voxels.uniformMaterial == VoxelMaterial_Air ? (Row)0 : ChunkVoxels::FullRow;
+			for (u32 i = 0; i < dim; i++)
+				plane[i] = fill;
+			continue;
+		}
+
+		const Row* rows = neighbour->voxels.Rows();
+
+		switch (dir)
+		{
+		case FaceDir_NegX:
+		case FaceDir_PosX:
+		{
+			// Only a single bit of each neighbour row touches this chunk, gather them into rows of y bits.
+			const u32 x = dir == FaceDir_NegX ? last : 0;
+			for (u32 z = 0; z < dim; z++)
+			{
+				Row bits = 0;
+				for (u32 y = 0; y < dim; y++)
+					bits |= (Row)(((rows[RowIndex(y, z)] >> x) & 1u) << y);
+
+				plane[z] = bits;
+			}
+			break;
+		}
+		case FaceDir_NegY:
+		case FaceDir_PosY:
+		{
+			const u32 y = dir == FaceDir_NegY ? last : 0;
+			for (u32 z = 0; z < dim; z++)
+				plane[z] = rows[RowIndex(y, z)];
+			break;
+		}
+		default:
+		{
+			const u32 z = dir == FaceDir_NegZ ? last : 0;
+			for (u32 y = 0; y < dim; y++)
+				plane[y] = rows[RowIndex(y, z)];
+			break;
+		}
+		}
+	}
+}
+
+void Chunk::DirtyBorderNeighbours(const u32 min[3], const u32 max[3])
+{
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		const u32 axis = dir / 2;
+		const bool positive = (dir & 1u) != 0;
+		if (positive ? max[axis] != dim : min[axis] != 0)
+			continue;
+
+		// Across an x or y border the neighbour's faces are in the same z slices, across a z border they are in its
+		// first or last slice.
+		if (Chunk* neighbour = neighbours[dir])
+			neighbour->dirtySections |= axis == 2 ? 1u << ChunkSectionOf(positive ? 0 : (u32)dim - 1) : ChunkSectionMask(min[2], max[2]);
+	}
+}
+
+// Render thread staging for vertex data padded out with collapsed quads.
+static std::vector<PackedVoxelVertex> g_MeshUploadVertices;
+
+bool Chunk::UploadMesh(const ChunkMeshData& data)
+{
+	const PackedVoxelVertex* rangeVertices[FaceDir_Count][k_ChunkSectionCount] = {};
+
+	const PackedVoxelVertex* vertices = data.vertices.data();
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		for (u32 section = 0; section < k_ChunkSectionCount; section++)
+		{
+			if (data.sectionMask & (1u << section))
+			{
+				rangeVertices[dir][section] = vertices;
+				vertices += (size_t)data.rangeQuadCount[dir][section] * 4;
+			}
+		}
+	}
+
+	if (data.sectionMask != k_AllChunkSections)
+	{
+		if (!mesh.layout)
+			return false;
+
+		MeshLayout& layout = *mesh.layout;
+
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32 section = 0; section < k_ChunkSectionCount; section++)
+			{
+				if ((data.sectionMask & (1u << section)) && data.rangeQuadCount[dir][section] > layout.rangeQuadCapacity[dir][section])
+					return false;
+			}
+		}
+
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32 section = 0; section < k_ChunkSectionCount; section++)
+			{
+				if ((data.sectionMask & (1u << section)) == 0)
+					continue;
+
+				const u32 quadCount = data.rangeQuadCount[dir][section];
+				const u32 oldQuadCount = layout.rangeQuadCount[dir][section];
+
+				// Shrinking ranges must also clear the quads they no longer use.
+				const u32 uploadQuads = Max(quadCount, oldQuadCount);
+				if (uploadQuads > 0)
+				{
+					g_MeshUploadVertices.assign(rangeVertices[dir][section], rangeVertices[dir][section] + (size_t)quadCount * 4);
+					g_MeshUploadVertices.resize((size_t)uploadQuads * 4, PackedVoxelVertex{ 0u });
+
+					UpdateVertexBuffer(mesh.vertexBuf, g_MeshUploadVertices.data(), g_MeshUploadVertices.size() * sizeof(PackedVoxelVertex),
+						(size_t)layout.rangeFirstQuad[dir][section] * 4 * sizeof(PackedVoxelVertex));
+				}
+
+				layout.rangeQuadCount[dir][section] = quadCount;
+				layout.faceQuadCount[dir] = layout.faceQuadCount[dir] - oldQuadCount + quadCount;
+				mesh.quadCount = mesh.quadCount - oldQuadCount + quadCount;
+			}
+		}
+
+		mesh.vertexCount = mesh.quadCount * 4;
+		return true;
+	}
+
+	Mesh newMesh;
+
+	if (!data.vertices.empty())
+	{
+		assert(data.QuadCount() <= k_MaxChunkQuads);
+
+		// Lay the ranges out with spare room, unless that would overflow the shared quad index buffer.
+		u32 drawQuadCount = 0;
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32 section = 0; section < k_ChunkSectionCount; section++)
+				drawQuadCount += RangeQuadCapacity(data.rangeQuadCount[dir][section]);
+		}
+
+		const bool spare = drawQuadCount <= k_MaxChunkQuads;
+
+		newMesh.layout.reset(new MeshLayout());
+		MeshLayout& newLayout = *newMesh.layout;
+
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32 section = 0; section < k_ChunkSectionCount; section++)
+			{
+				const u32 quadCount = data.rangeQuadCount[dir][section];
+
+				newLayout.rangeQuadCount[dir][section] = quadCount;
+				newLayout.rangeFirstQuad[dir][section] = newMesh.drawQuadCount;
+				newLayout.rangeQuadCapacity[dir][section] = spare ? RangeQuadCapacity(quadCount) : quadCount;
+				newMesh.drawQuadCount += newLayout.rangeQuadCapacity[dir][section];
+				newLayout.faceQuadCount[dir] += quadCount;
+			}
+		}
+
+		g_MeshUploadVertices.assign((size_t)newMesh.drawQuadCount * 4, PackedVoxelVertex{ 0u });
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32 section = 0; section < k_ChunkSectionCount; section++)
+			{
+				std::copy(rangeVertices[dir][section], rangeVertices[dir][section] + (size_t)data.rangeQuadCount[dir][section] * 4,
+					g_MeshUploadVertices.begin() + (size_t)newLayout.rangeFirstQuad[dir][section] * 4);
+			}
+		}
+
+		newMesh.vertexBuf = CreateVertexBuffer(g_MeshUploadVertices.data(), g_MeshUploadVertices.size() * sizeof(PackedVoxelVertex));
+		newMesh.stride = (u32)sizeof(PackedVoxelVertex);
+		newMesh.offset = 0u;
+
+		newMesh.vertexCount = (u32)data.vertices.size();
+		newMesh.quadCount = data.QuadCount();
+	}
+
+	Render_Release(mesh.vertexBuf);
+	mesh = std::move(newMesh);
+
+	return true;
+}
+
+void Chunk::ReleaseMesh()
+{
+	Render_Release(mesh.vertexBuf);
+	mesh = Mesh();
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "Render/Render.h"
+#include "Surf/SurfMath.h"
+
+#include <memory>
+#include <vector>
+
+constexpr float VoxelSize = 1.0f;
+constexpr float VoxelExtent = VoxelSize * 0.5f;
+
+struct ChunkBorders;
+struct ChunkMeshData;
+
+enum FaceDir : u8
+{
+	FaceDir_NegX,
+	FaceDir_PosX,
+	FaceDir_NegY,
+	FaceDir_PosY,
+	FaceDir_NegZ,
+	FaceDir_PosZ,
+	FaceDir_Count,
+};
+
+inline FaceDir OppositeFaceDir(FaceDir dir) { return (FaceDir)(dir ^ 1u); }
+
+// What a voxel is made of. Must match MaterialColors in Mesh.hlsl.
+enum VoxelMaterial : u8
+{
+	VoxelMaterial_Air,
+	VoxelMaterial_Stone,
+	VoxelMaterial_Dirt,
+	VoxelMaterial_Grass,
+	VoxelMaterial_Count,
+};
+
+// Chunks are 1 << VOXELS_PER_CHUNK voxels along each axis, 16, 32 or 64. Bigger chunks mean fewer draws and chunk
+// lookups but more to remesh per edit.
+#ifndef VOXELS_PER_CHUNK
+#define VOXELS_PER_CHUNK 4u
+#endif
+
+// The smallest unsigned type with one bit per voxel in a chunk row.
+template<size_t Dim> struct ChunkRowType;
+template<> struct ChunkRowType<16> { typedef u16 Type; };
+template<> struct ChunkRowType<32> { typedef u32 Type; };
+template<> struct ChunkRowType<64> { typedef u64 Type; };
+
+// Order of the occupancy rows within a chunk. Zero stores them z major, one interleaves the bits of y and z in Morton
+// order so rows near each other in both y and z are near each other in memory. Each row stays a bitmask along x
+// either way, so meshing and bulk edits still work a row at a time.
+#ifndef VOXEL_MORTON_LAYOUT
+#define VOXEL_MORTON_LAYOUT 0
+#endif
+
+// Spreads the low 16 bits of v out to the even bits.
+inline u32 MortonSpread(u32 v)
+{
+	v &= 0x0000FFFFu;
+	v = (v | (v << 8)) & 0x00FF00FFu;
+	v = (v | (v << 4)) & 0x0F0F0F0Fu;
+	v = (v | (v << 2)) & 0x33333333u;
+	v = (v | (v << 1)) & 0x55555555u;
+	return v;
+}
+
+// Gathers the even bits of v back into the low 16 bits.
+inline u32 MortonCompact(u32 v)
+{
+	v &= 0x55555555u;
+	v = (v | (v >> 1)) & 0x33333333u;
+	v = (v | (v >> 2)) & 0x0F0F0F0Fu;
+	v = (v | (v >> 4)) & 0x00FF00FFu;
+	v = (v | (v >> 8)) & 0x0000FFFFu;
+	return v;
+}
+
+// The voxel contents of a chunk, kept apart from its render state so meshing jobs can work on a copy.
+struct ChunkVoxels
+{
+	static const size_t dim = (size_t)1 << VOXELS_PER_CHUNK;
+
+	// Occupancy is stored as one bitmask per row along x, so meshing can work on a whole row at once.
+	typedef typename ChunkRowType<dim>::Type Row;
+	static_assert(sizeof(Row) * 8 == dim, "ChunkVoxels::Row must hold exactly one bit per voxel in a row");
+
+	static constexpr Row FullRow = (Row)~(Row)0;
+
+	// Empty while the chunk is uniform, every voxel is then uniformMaterial. Most chunks are all air or buried, so the
+	// rows are only allocated the first time a chunk becomes mixed.
+	std::vector<Row> rows;
+	VoxelMaterial uniformMaterial = VoxelMaterial_Air;
+
+	// Materials are palette compressed on top of the occupancy. The palette lists the materials used in the chunk
+	// with air first, and each voxel stores an index into it packed at the smallest power of two width that fits.
+	// While the chunk only uses one material no indices are stored, solid voxels use palette entry one.
+	// Entries are never removed, so a chunk keeps the width of the most materials it has held.
+	std::vector<VoxelMaterial> palette = { VoxelMaterial_Air };
+	std::vector<u64> indices;
+	u32 indexBits = 0;
+
+#if VOXEL_MORTON_LAYOUT
+	static size_t RowIndex(u32 y, u32 z) { return MortonSpread(y) | (MortonSpread(z) << 1); }
+	static u32 RowY(size_t row) { return MortonCompact((u32)row); }
+	static u32 RowZ(size_t row) { return MortonCompact((u32)row >> 1); }
+#else
+	static size_t RowIndex(u32 y, u32 z) { return (z * dim) + y; }
+	static u32 RowY(size_t row) { return (u32)(row % dim); }
+	static u32 RowZ(size_t row) { return (u32)(row / dim); }
+#endif
+
+	static size_t VoxelIndex(u32 x, u32 y, u32 z) { return RowIndex(y, z) * dim + x; }
+
+	// Calls fn(row, y, z) for every row, in the order they are stored.
+	template<typename Fn>
+	static void ForEachRow(Fn&& fn)
+	{
+		for (size_t row = 0; row < dim * dim; row++)
+			fn(row, RowY(row), RowZ(row));
+	}
+
+	// Calls fn(row, y, z) for every row in the z slices from zBegin up to but not including zEnd. Only contiguous in
+	// the linear layout.
+	template<typename Fn>
+	static void ForEachRowInSlices(u32 zBegin, u32 zEnd, Fn&& fn)
+	{
+		for (u32 z = zBegin; z < zEnd; z++)
+		{
+			for (u32 y = 0; y < dim; y++)
+				fn(RowIndex(y, z), y, z);
+		}
+	}
+
+	bool IsUniform() const { return rows.empty(); }
+
+	// All dim * dim rows, a shared table of empty or full rows while the chunk is uniform.
+	const Row* Rows() const;
+
+	bool Empty(u32 x, u32 y, u32 z) const { return ((Rows()[RowIndex(y, z)] >> x) & 1u) == 0; }
+
+	u32 PaletteIndex(u32 x, u32 y, u32 z) const
+	{
+		if (indexBits == 0)
+			return Empty(x, y, z) ? 0u : 1u;
+
+		const size_t bit = VoxelIndex(x, y, z) * indexBits;
+		return (u32)(indices[bit / 64] >> (bit % 64)) & ((1u << indexBits) - 1u);
+	}
+
+	VoxelMaterial Material(u32 x, u32 y, u32 z) const { return palette[PaletteIndex(x, y, z)]; }
+
+	// Setting air removes the voxel.
+	void Set(u32 x, u32 y, u32 z, VoxelMaterial material = VoxelMaterial_Stone);
+	void Remove(u32 x, u32 y, u32 z);
+
+	// Makes every voxel material, releasing the rows and indices.
+	void Fill(VoxelMaterial material);
+
+	// Sets the voxels of one row whose bits are in mask, writing the occupancy and indices a whole word at a time.
+	void FillRow(u32 y, u32 z, Row mask, VoxelMaterial material);
+
+	// Sets every voxel from min up to but not including max. Covering the whole chunk makes it uniform.
+	void FillBox(u32 minX, u32 minY, u32 minZ, u32 maxX, u32 maxY, u32 maxZ, VoxelMaterial material);
+
+	// Goes back to the uniform representation if every voxel has ended up the same. Returns true if it did.
+	bool Compact();
+
+	// Splits the occupancy of the z slices from zBegin up to but not including zEnd by palette entry, writing rows laid
+	// out like ChunkVoxels::rows for each entry to materialRows[entry * dim * dim]. Entry zero, air, is left empty.
+	void GatherMaterialRows(u32 zBegin, u32 zEnd, Row* materialRows) const;
+
+	// The chunk is split into 4x4x4 bricks of brickDim voxels, BrickMask has bit bx | by << 2 | bz << 4 set for
+	// every brick holding a solid voxel.
+	static const size_t brickDim = dim / 4;
+	u64 BrickMask() const;
+
+	// Heap memory held by the rows, palette and indices.
+	size_t HeapBytes() const { return rows.capacity() * sizeof(Row) + palette.capacity() * sizeof(VoxelMaterial) + indices.capacity() * sizeof(u64); }
+
+private:
+	void MakeMixed();
+	u32 FindOrAddPaletteEntry(VoxelMaterial material);
+	void SetPaletteIndex(size_t voxelIndex, u32 paletteIndex);
+	void Repack(u32 newIndexBits);
+};
+
+// Chunks are meshed in sections of whole z slices, so an edit only has to remesh the sections it touches.
+constexpr u32 k_ChunkSectionSlices = 4;
+constexpr u32 k_ChunkSectionCount = (u32)ChunkVoxels::dim / k_ChunkSectionSlices;
+static_assert(ChunkVoxels::dim % k_ChunkSectionSlices == 0, "Chunk sections must evenly split the chunk");
+constexpr u32 k_AllChunkSections = (1u << k_ChunkSectionCount) - 1u;
+
+inline u32 ChunkSectionOf(u32 z) { return z / k_ChunkSectionSlices; }
+
+// The sections covering the z slices from zBegin up to but not including zEnd.
+inline u32 ChunkSectionMask(u32 zBegin, u32 zEnd)
+{
+	if (zBegin >= zEnd)
+		return 0;
+
+	return ((2u << ChunkSectionOf(zEnd - 1)) - 1u) & ~((1u << ChunkSectionOf(zBegin)) - 1u);
+}
+
+// Chunk meshes are made of quads indexed with the shared chunk quad index buffer, so only carry vertices.
+// Quads are grouped by face direction so faces pointing away from the camera can be skipped when drawing, then by
+// section. Each direction and section owns a fixed range of the vertex buffer with some spare room, so a remeshed
+// section can be patched in place. Unused quads in a range are zeroed, which collapses them to a point and lets all
+// of a direction draw in one call.
+struct MeshLayout
+{
+	u32 rangeQuadCount[FaceDir_Count][k_ChunkSectionCount] = {};
+	u32 rangeFirstQuad[FaceDir_Count][k_ChunkSectionCount] = {};
+	u32 rangeQuadCapacity[FaceDir_Count][k_ChunkSectionCount] = {};
+
+	u32 faceQuadCount[FaceDir_Count] = {};
+};
+
+struct Mesh
+{
+	VertexBuffer_t vertexBuf = VertexBuffer_t::INVALID;
+	u32 vertexCount = 0;
+	u32 quadCount = 0;
+	u32 stride = 0;
+	u32 offset = 0;
+
+	// Quads drawn, including the spare room between ranges.
+	u32 drawQuadCount = 0;
+
+	// Only allocated for meshes with quads, so the many chunks with nothing to draw stay small.
+	std::unique_ptr<MeshLayout> layout;
+
+	u32 IndexCount() const { return drawQuadCount * 6u; }
+
+	// Size of the vertex buffer, spare room included.
+	size_t VertexBufferBytes() const { return (size_t)drawQuadCount * 4u * stride; }
+
+	u32 FaceQuadCount(FaceDir dir) const { return layout ? layout->faceQuadCount[dir] : 0u; }
+
+	// The quads covering every section of one direction, spare room included.
+	u32 FaceFirstQuad(FaceDir dir) const { return layout->rangeFirstQuad[dir][0]; }
+	u32 FaceDrawQuadCount(FaceDir dir) const { return (dir + 1 < FaceDir_Count ? layout->rangeFirstQuad[dir + 1][0] : drawQuadCount) - layout->rangeFirstQuad[dir][0]; }
+};
+
+// Which face directions of a chunk spanning boundsMin to boundsMax could face the viewer, one bit per FaceDir.
+// A face can only be seen from in front of its plane, and every plane of a direction lies within the bounds.
+inline u32 ChunkVisibleFaces(const float3& boundsMin, const float3& boundsMax, const float3& viewPosition)
+{
+	u32 visible = 0;
+	visible |= viewPosition.x < boundsMax.x ? (1u << FaceDir_NegX) : 0u;
+	visible |= viewPosition.x > boundsMin.x ? (1u << FaceDir_PosX) : 0u;
+	visible |= viewPosition.y < boundsMax.y ? (1u << FaceDir_NegY) : 0u;
+	visible |= viewPosition.y > boundsMin.y ? (1u << FaceDir_PosY) : 0u;
+	visible |= viewPosition.z < boundsMax.z ? (1u << FaceDir_NegZ) : 0u;
+	visible |= viewPosition.z > boundsMin.z ? (1u << FaceDir_PosZ) : 0u;
+	return visible;
+}
+
+struct Chunk
+{
+	static const size_t dim = ChunkVoxels::dim;
+	typedef ChunkVoxels::Row Row;
+
+	ChunkVoxels voxels;
+
+	Mesh mesh;
+
+	// One bit per section that needs remeshing.
+	u32 dirtySections = k_AllChunkSections;
+
+	// A snapshot of this chunk is being meshed, the current mesh keeps drawing until the result is swapped in.
+	bool meshJobPending = false;
+
+	// The adjacent chunk in each FaceDir, null where there is none. Kept up to date by ChunkMap as chunks are added,
+	// so crossing a chunk border never needs a lookup.
+	Chunk* neighbours[FaceDir_Count] = {};
+
+	// ChunkVoxels::BrickMask as of the last VoxelWorld::UpdateOccupancy. Edits flag the chunk stale and queue it with
+	// the world rather than recomputing it straight away.
+	u64 brickMask = 0;
+	bool occupancyStale = false;
+
+	// The last ChunkResidency frame the chunk was drawn or within the resident distance, used to pick chunks to evict.
+	u32 lastVisibleFrame = 0;
+
+	bool IsDirty() const { return dirtySections != 0; }
+	void MarkDirty() { dirtySections = k_AllChunkSections; }
+
+	static size_t RowIndex(u32 y, u32 z) { return ChunkVoxels::RowIndex(y, z); }
+	bool Empty(u32 x, u32 y, u32 z) const { return voxels.Empty(x, y, z); }
+	VoxelMaterial Material(u32 x, u32 y, u32 z) const { return voxels.Material(x, y, z); }
+	void Set(u32 x, u32 y, u32 z, VoxelMaterial material = VoxelMaterial_Stone) { voxels.Set(x, y, z, material); DirtyVoxel(z); }
+	void Remove(u32 x, u32 y, u32 z) { voxels.Remove(x, y, z); DirtyVoxel(z); }
+
+	void FillBox(u32 minX, u32 minY, u32 minZ, u32 maxX, u32 maxY, u32 maxZ, VoxelMaterial material)
+	{
+		voxels.FillBox(minX, minY, minZ, maxX, maxY, maxZ, material);
+		DirtySlices(minZ, maxZ);
+	}
+
+	// Changing a voxel changes the faces of the voxels either side of it in z, which may be in the adjacent sections.
+	void DirtyVoxel(u32 z) { DirtySlices(z, z + 1); }
+
+	void DirtySlices(u32 zBegin, u32 zEnd)
+	{
+		dirtySections |= ChunkSectionMask(zBegin > 0 ? zBegin - 1 : 0, zEnd < dim ? zEnd + 1 : (u32)dim);
+	}
+
+	// An edit covering the chunk local box min to max, not including max, changes which faces are visible in the
+	// neighbours it touches.
+	void DirtyBorderNeighbours(const u32 min[3], const u32 max[3]);
+
+	// Fills in the border slices of the adjacent chunks for face culling across chunk boundaries.
+	void GatherBorders(ChunkBorders& borders) const;
+
+	// Swaps in freshly meshed data. When every section was meshed the vertex buffer is recreated, otherwise the ranges
+	// of the meshed sections are patched in place. Returns false if a patched section has outgrown its range, in which case the
+	// mesh is left untouched and the whole chunk needs meshing again. Must be called on the render thread.
+	bool UploadMesh(const ChunkMeshData& data);
+
+	// Frees the vertex buffer and leaves the chunk with nothing to draw. Must be called on the render thread.
+	void ReleaseMesh();
+
+	// Memory the chunk holds on the CPU, itself included, and in vertex buffers.
+	size_t CpuBytes() const { return sizeof(Chunk) + voxels.HeapBytes() + (mesh.layout ? sizeof(MeshLayout) : 0); }
+	size_t GpuBytes() const { return mesh.VertexBufferBytes(); }
+};
+
+// Every quad uses the same index pattern, so all chunk meshes share one index buffer sized for the worst case chunk.
+// Uses 16 bit indices when the worst case vertex count allows it.
+bool ChunkQuadIndices_Init();
+void ChunkQuadIndices_Release();
+IndexBuffer_t ChunkQuadIndices_Buffer();
+RenderFormat ChunkQuadIndices_Format();
@@ -0,0 +1,71 @@
+#include "ChunkMap.h"
+
+Chunk& ChunkMap::Add(const ChunkCoord& cc)
+{
+	u32 index;
+	if (!freeIndices.empty())
+	{
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else
+	{
+		if (poolSize % PageSize == 0)
+			pages.emplace_back(new Entry[PageSize]);
+
+		index = poolSize++;
+	}
+
+	Entry& entry = pages[index / PageSize][index % PageSize];
+	entry.coord = cc;
+	entry.live = true;
+
+	indices.Add(cc, index);
+
+	const ColumnKey columnKey{ cc.coord.x, cc.coord.z };
+	Column* column = columns.Find(columnKey);
+	if (!column)
+	{
+		columns.Add(columnKey, Column());
+		column = columns.Find(columnKey);
+	}
+
+	column->top = Max(column->top, cc.coord.y + (u32)Chunk::dim);
+	column->chunkCount++;
+
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		Chunk* neighbour = Find(cc.Neighbour((FaceDir)dir));
+		entry.chunk.neighbours[dir] = neighbour;
+		if (neighbour)
+			neighbour->neighbours[OppositeFaceDir((FaceDir)dir)] = &entry.chunk;
+	}
+
+	return entry.chunk;
+}
+
+bool ChunkMap::Remove(const ChunkCoord& cc)
+{
+	u32 index;
+	if (!indices.Remove(cc, &index))
+		return false;
+
+	Entry& entry = pages[index / PageSize][index % PageSize];
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		if (Chunk* neighbour = entry.chunk.neighbours[dir])
+			neighbour->neighbours[OppositeFaceDir((FaceDir)dir)] = nullptr;
+	}
+
+	entry.chunk = Chunk();
+	entry.live = false;
+
+	freeIndices.push_back(index);
+
+	const ColumnKey columnKey{ cc.coord.x, cc.coord.z };
+	Column* column = columns.Find(columnKey);
+	if (--column->chunkCount == 0)
+		columns.Remove(columnKey);
+
+	return true;
+}
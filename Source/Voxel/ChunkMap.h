@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Chunk.h"
+#include "RobinHoodMap.h"
+#include "VoxelCoord.h"
+
+#include <memory>
+#include <vector>
+
+// Chunks keyed by ChunkCoord. Chunks live in a pool of fixed size pages, so they sit next to each other in memory and
+// never move once added, and are indexed by an open addressing table using Robin Hood linear probing. Removed chunks
+// leave a hole in the pool that the next added chunk reuses.
+class ChunkMap
+{
+public:
+	struct Entry
+	{
+		ChunkCoord coord{ 0u, 0u, 0u };
+		Chunk chunk;
+
+		// False for pool entries that are free.
+		bool live = false;
+	};
+
+	template<typename EntryType>
+	class Iterator
+	{
+	public:
+		Iterator(const std::unique_ptr<Entry[]>* pages, u32 index, u32 end) : pages(pages), index(index), end(end) { SkipFree(); }
+
+		EntryType& operator*() const { return pages[index / PageSize][index % PageSize]; }
+		EntryType* operator->() const { return &**this; }
+		Iterator& operator++() { index++; SkipFree(); return *this; }
+		bool operator!=(const Iterator& other) const { return index != other.index; }
+
+	private:
+		void SkipFree()
+		{
+			while (index < end && !pages[index / PageSize][index % PageSize].live)
+				index++;
+		}
+
+		const std::unique_ptr<Entry[]>* pages;
+		u32 index;
+		u32 end;
+	};
+
+	typedef Iterator<Entry> iterator;
+	typedef Iterator<const Entry> const_iterator;
+
+	ChunkMap() = default;
+	ChunkMap(const ChunkMap&) = delete;
+	ChunkMap& operator=(const ChunkMap&) = delete;
+
+	Chunk* Find(const ChunkCoord& cc)
+	{
+		const u32* index = indices.Find(cc);
+		return index ? &pages[*index / PageSize][*index % PageSize].chunk : nullptr;
+	}
+
+	const Chunk* Find(const ChunkCoord& cc) const
+	{
+		const u32* index = indices.Find(cc);
+		return index ? &pages[*index / PageSize][*index % PageSize].chunk : nullptr;
+	}
+
+	// Adds a default chunk if there isn't one at cc yet.
+	Chunk& FindOrAdd(const ChunkCoord& cc)
+	{
+		const u32* index = indices.Find(cc);
+		return index ? pages[*index / PageSize][*index % PageSize].chunk : Add(cc);
+	}
+
+	// Removes the chunk at cc and unlinks it from its neighbours, returning false if there wasn't one. The chunk is
+	// reset, so its mesh must already have been released.
+	bool Remove(const ChunkCoord& cc);
+
+	// One past the highest chunk of the column at x, z, in voxels. It only drops back to zero once the column has no
+	// chunks left, so every chunk of the column lies below it.
+	u32 ColumnTop(u32 x, u32 z) const
+	{
+		const Column* column = columns.Find({ x & CHUNK_MASK, z & CHUNK_MASK });
+		return column ? column->top : 0;
+	}
+
+	size_t size() const { return indices.size(); }
+	bool empty() const { return indices.empty(); }
+
+	// Iterates in pool order, walking the pool pages in turn and skipping free entries.
+	iterator begin() { return iterator(pages.data(), 0, poolSize); }
+	iterator end() { return iterator(pages.data(), poolSize, poolSize); }
+	const_iterator begin() const { return const_iterator(pages.data(), 0, poolSize); }
+	const_iterator end() const { return const_iterator(pages.data(), poolSize, poolSize); }
+
+private:
+	static constexpr u32 PageSize = 64;
+
+	Chunk& Add(const ChunkCoord& cc);
+
+	// The pool index of each chunk. Coordinates are stored in full in the table so lookups never need to touch the
+	// pool.
+	RobinHoodMap<ChunkCoord, u32, ChunkCoordHash> indices;
+
+	struct ColumnKey
+	{
+		u32 x = 0;
+		u32 z = 0;
+
+		bool operator==(const ColumnKey& other) const { return x == other.x && z == other.z; }
+	};
+
+	struct ColumnKeyHash
+	{
+		u64 operator()(const ColumnKey& key) const { return HashCoord(key.x, 0, key.z); }
+	};
+
+	struct Column
+	{
+		u32 top = 0;
+		u32 chunkCount = 0;
+	};
+
+	// Only columns with chunks in them are kept.
+	RobinHoodMap<ColumnKey, Column, ColumnKeyHash> columns;
+
+	std::vector<std::unique_ptr<Entry[]>> pages;
+
+	// Pool entries in use or freed, and the freed ones waiting to be reused.
+	u32 poolSize = 0;
+	std::vector<u32> freeIndices;
+};
@@ -0,0 +1,180 @@
+#include "ChunkMeshScheduler.h"
+
+#include "Surf/HighResolutionClock.h"
+#include "Surf/JobSystem.h"
+
+#include <algorithm>
+
+void ChunkMeshScheduler::Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, MeshingMode mode, MeshingStats* stats)
+{
+	UploadReady(stats);
+	Dispatch(world, jobs, viewPosition, viewDir, mode, stats);
+
+	if (stats)
+	{
+		stats->chunksInFlight = inFlight;
+		stats->meshingThreads = jobs.GetWorkerCount();
+	}
+}
+
+void ChunkMeshScheduler::UploadReady(MeshingStats* stats)
+{
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		ready.insert(ready.end(), completed.begin(), completed.end());
+		completed.clear();
+	}
+
+	if (ready.empty())
+		return;
+
+	// Most important first, the vector is consumed from the back.
+	std::sort(ready.begin(), ready.end(), [](const MeshJob* a, const MeshJob* b) { return a->priority > b->priority; });
+
+	HighResolutionClock clock;
+	double uploadMs = 0.0;
+	size_t uploadBytes = 0;
+	u32 uploadCount = 0;
+
+	while (!ready.empty())
+	{
+		// Always make progress by uploading at least one mesh a frame.
+		if (uploadCount > 0 && (uploadMs >= uploadBudgetMs || uploadBytes >= uploadBudgetBytes))
+			break;
+
+		MeshJob* job = ready.back();
+		ready.pop_back();
+
+		// Sections that outgrew their range can't be patched in, so mesh the whole chunk again to lay it out afresh.
+		if (!job->chunk->UploadMesh(job->data))
+			job->chunk->MarkDirty();
+
+		job->chunk->meshJobPending = false;
+
+		uploadBytes += job->data.vertices.size() * sizeof(PackedVoxelVertex);
+		uploadCount++;
+
+		clock.Tick();
+		uploadMs += clock.GetDeltaMilliseconds();
+
+		if (stats)
+		{
+			stats->chunksRebuilt++;
+			stats->vertexCount += job->data.vertices.size();
+			stats->quadCount += job->data.QuadCount();
+			stats->meshMilliseconds += job->meshMilliseconds;
+		}
+
+		freeJobs.push_back(job);
+		inFlight--;
+	}
+
+	if (stats)
+		stats->uploadMilliseconds += uploadMs;
+}
+
+void ChunkMeshScheduler::Dispatch(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, MeshingMode mode, MeshingStats* stats)
+{
+	constexpr float chunkExtent = Chunk::dim * VoxelSize * 0.5f;
+	constexpr float chunkRadius = chunkExtent * 1.7320508f;
+
+	candidates.clear();
+
+	for (ChunkMap::Entry& entry : world.chunks)
+	{
+		Chunk& chunk = entry.chunk;
+		if (!chunk.IsDirty() || chunk.meshJobPending)
+			continue;
+
+		const ChunkCoord& cc = entry.coord;
+
+		const float3 centre = float3(cc.coord.x, cc.coord.y, cc.coord.z) * VoxelSize + float3(chunkExtent - VoxelExtent);
+		const float3 toChunk = centre - viewPosition;
+
+		// Chunks entirely behind the camera can't be seen until it turns, so let everything in front go first.
+		float priority = LengthSqrF3(toChunk);
+		if (DotF3(toChunk, viewDir) < -chunkRadius)
+			priority *= 4.0f;
+
+		candidates.push_back({ cc, &chunk, priority });
+	}
+
+	const size_t freeSlots = maxJobsInFlight > inFlight ? maxJobsInFlight - inFlight : 0;
+	const size_t dispatchCount = Min(freeSlots, candidates.size());
+
+	if (stats)
+		stats->chunksWaiting = (u32)(candidates.size() - dispatchCount);
+
+	if (dispatchCount == 0)
+		return;
+
+	std::partial_sort(candidates.begin(), candidates.begin() + dispatchCount, candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority < b.priority; });
+
+	for (size_t i = 0; i < dispatchCount; i++)
+	{
+		const Candidate& candidate = candidates[i];
+		Chunk& chunk = *candidate.chunk;
+
+		// Chunks that are all air, or all solid with solid all around, have nothing to draw. Drop their mesh here
+		// rather than spending a job on them. Only chunks about to be meshed are compacted, the rest can wait for
+		// their turn.
+		chunk.voxels.Compact();
+		if (chunk.voxels.IsUniform())
+		{
+			bool empty = chunk.voxels.uniformMaterial == VoxelMaterial_Air;
+			if (!empty)
+			{
+				chunk.GatherBorders(uniformBorders);
+				empty = uniformBorders.AllSolid();
+			}
+
+			if (empty)
+			{
+				if (chunk.mesh.vertexBuf != VertexBuffer_t::INVALID)
+				{
+					emptyMeshData.sectionMask = k_AllChunkSections;
+					chunk.UploadMesh(emptyMeshData);
+					if (stats)
+						stats->chunksRebuilt++;
+				}
+
+				chunk.dirtySections = 0;
+				continue;
+			}
+		}
+
+		if (freeJobs.empty())
+		{
+			jobPool.push_back(std::make_unique<MeshJob>());
+			freeJobs.push_back(jobPool.back().get());
+		}
+
+		MeshJob* job = freeJobs.back();
+		freeJobs.pop_back();
+
+		// Snapshot so the workers never touch the live world, edits made from here on dirty the chunk again.
+		job->chunk = candidate.chunk;
+		job->priority = candidate.priority;
+		job->mode = mode;
+		job->voxels = chunk.voxels;
+		chunk.GatherBorders(job->borders);
+
+		// Without a vertex buffer there are no section ranges to patch.
+		job->sectionMask = chunk.mesh.vertexBuf != VertexBuffer_t::INVALID ? chunk.dirtySections : k_AllChunkSections;
+
+		chunk.dirtySections = 0;
+		chunk.meshJobPending = true;
+		inFlight++;
+
+		jobs.Submit([this, job]()
+		{
+			HighResolutionClock clock;
+			MeshChunk(job->voxels, job->borders, job->mode, job->sectionMask, job->data);
+			clock.Tick();
+			job->meshMilliseconds = clock.GetDeltaMilliseconds();
+
+			std::lock_guard<std::mutex> lock(completedMutex);
+			completed.push_back(job);
+		});
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ChunkMesher.h"
+#include "VoxelWorld.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class JobSystem;
+
+// Remeshes dirty chunks asynchronously on the job system. Each frame finished meshes are swapped in on the render
+// thread until the upload budget runs out, chunks keep drawing their previous mesh until then. Dirty chunks are
+// dispatched closest to the camera first, with chunks behind the camera pushed back.
+struct ChunkMeshScheduler
+{
+	float uploadBudgetMs = 2.0f;
+	u32 uploadBudgetBytes = 4u * 1024u * 1024u;
+	u32 maxJobsInFlight = 64;
+
+	ChunkMeshScheduler() = default;
+	ChunkMeshScheduler(const ChunkMeshScheduler&) = delete;
+	ChunkMeshScheduler& operator=(const ChunkMeshScheduler&) = delete;
+
+	// Call once per frame on the render thread.
+	void Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, MeshingMode mode, MeshingStats* stats = nullptr);
+
+	u32 InFlightCount() const { return inFlight; }
+
+private:
+	struct MeshJob
+	{
+		Chunk* chunk = nullptr;
+		float priority = 0.0f;
+		MeshingMode mode = {};
+		u32 sectionMask = 0;
+		ChunkVoxels voxels;
+		ChunkBorders borders;
+		ChunkMeshData data;
+		double meshMilliseconds = 0.0;
+	};
+
+	struct Candidate
+	{
+		ChunkCoord coord;
+		Chunk* chunk;
+		float priority;
+	};
+
+	void UploadReady(MeshingStats* stats);
+	void Dispatch(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, MeshingMode mode, MeshingStats* stats);
+
+	// Written by the workers as jobs finish.
+	std::mutex completedMutex;
+	std::vector<MeshJob*> completed;
+
+	// Finished jobs waiting on upload budget, render thread only.
+	std::vector<MeshJob*> ready;
+
+	std::vector<std::unique_ptr<MeshJob>> jobPool;
+	std::vector<MeshJob*> freeJobs;
+	std::vector<Candidate> candidates;
+	u32 inFlight = 0;
+
+	// Swapped in for chunks skipped as uniform.
+	ChunkMeshData emptyMeshData;
+	ChunkBorders uniformBorders;
+};
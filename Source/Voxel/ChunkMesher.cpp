@@ -0,0 +1,400 @@
+#include "ChunkMesher.h"
+
+#include <algorithm>
+#include <memory>
+
+// Corner signs for each face, wound to match the shared chunk quad index pattern.
+static constexpr i8 k_FaceCorners[FaceDir_Count][4][3] =
+{
+	{ { -1,  1, -1 }, { -1,  1,  1 }, { -1, -1,  1 }, { -1, -1, -1 } }, // -X
+	{ {  1,  1,  1 }, {  1,  1, -1 }, {  1, -1, -1 }, {  1, -1,  1 } }, // +X
+	{ { -1, -1,  1 }, {  1, -1,  1 }, {  1, -1, -1 }, { -1, -1, -1 } }, // -Y
+	{ { -1,  1,  1 }, { -1,  1, -1 }, {  1,  1, -1 }, {  1,  1,  1 } }, // +Y
+	{ {  1,  1, -1 }, { -1,  1, -1 }, { -1, -1, -1 }, {  1, -1, -1 } }, // -Z
+	{ { -1,  1,  1 }, {  1,  1,  1 }, {  1, -1,  1 }, { -1, -1,  1 } }, // +Z
+};
+
+const char* MeshingModeName(MeshingMode mode)
+{
+	switch (mode)
+	{
+	case MeshingMode::PerFace: return "Per Face";
+	case MeshingMode::Greedy: return "Greedy";
+	case MeshingMode::Binary: return "Binary Greedy";
+	default: return "Unknown";
+	}
+}
+
+// A single direction can at most have a face on every solid voxel of a 3D checkerboard.
+constexpr u32 k_MaxChunkFaceQuads = k_MaxChunkQuads / FaceDir_Count;
+
+// A chunk palette lists each material at most once, air included.
+constexpr size_t k_MaxPaletteSize = VoxelMaterial_Count;
+
+// Vertex storage the meshers write into, one region per face direction each sized for the worst case chunk so
+// meshing never has to grow it. Each thread gets its own the first time it meshes and keeps it, the result is copied
+// out into the caller's ChunkMeshData.
+struct MeshScratch
+{
+	std::unique_ptr<PackedVoxelVertex[]> vertices{ new PackedVoxelVertex[(size_t)k_MaxChunkQuads * 4] };
+	u32 vertexCount[FaceDir_Count] = {};
+
+	// Exposed faces per direction for the binary mesher, too big for the stack with the largest chunks.
+	std::unique_ptr<u64[][ChunkVoxels::dim * ChunkVoxels::dim]> faces{ new u64[FaceDir_Count][ChunkVoxels::dim * ChunkVoxels::dim] };
+
+	// Occupancy split by palette entry for the binary mesher.
+	std::unique_ptr<ChunkVoxels::Row[]> materialRows{ new ChunkVoxels::Row[k_MaxPaletteSize * ChunkVoxels::dim * ChunkVoxels::dim] };
+
+	// +-X faces for the binary mesher, a plane of y bits per z for each x.
+	std::unique_ptr<u64[][ChunkVoxels::dim]> xPlanes{ new u64[ChunkVoxels::dim][ChunkVoxels::dim] };
+
+	PackedVoxelVertex* Face(u32 dir) { return &vertices[(size_t)dir * k_MaxChunkFaceQuads * 4]; }
+};
+
+static thread_local MeshScratch g_MeshScratch;
+
+// Emits a quad covering the voxels from min to max inclusive on the given face.
+static void EmitQuad(MeshScratch& out, FaceDir dir, VoxelMaterial material, const u32 min[3], const u32 max[3])
+{
+	assert(out.vertexCount[dir] + 4 <= k_MaxChunkFaceQuads * 4);
+
+	PackedVoxelVertex* vertex = out.Face(dir) + out.vertexCount[dir];
+	out.vertexCount[dir] += 4;
+
+	for (u32 i = 0; i < 4; i++)
+	{
+		// Voxels are centred on their coordinate, so the far corner of max is max + 1 once offset by the extent.
+		u32 corner[3];
+		for (u32 axis = 0; axis < 3; axis++)
+			corner[axis] = k_FaceCorners[dir][i][axis] < 0 ? min[axis] : max[axis] + 1;
+
+		vertex[i] = PackedVoxelVertex::Pack(corner[0], corner[1], corner[2], dir, material);
+	}
+}
+
+// Each mesher covers the z slices from zBegin up to but not including zEnd.
+static void MeshChunkPerFace(const ChunkVoxels& chunk, const ChunkBorders& borders, u32 zBegin, u32 zEnd, MeshScratch& out)
+{
+	constexpr u32 dim = (u32)ChunkVoxels::dim;
+
+	auto AddFace = [&](FaceDir dir, u32 x, u32 y, u32 z)
+	{
+		const u32 coord[3] = { x, y, z };
+		EmitQuad(out, dir, chunk.Material(x, y, z), coord, coord);
+	};
+
+	for (u32 z = zBegin; z < zEnd; z++)
+	{
+		for (u32 y = 0; y < dim; y++)
+		{
+			for (u32 x = 0; x < dim; x++)
+			{
+				if (chunk.Empty(x, y, z))
+					continue;
+
+				if (z <= 0 ? !borders.Solid(FaceDir_NegZ, x, y, z) : chunk.Empty(x, y, z - 1))
+					AddFace(FaceDir_NegZ, x, y, z);
+
+				if (z >= (dim - 1) ? !borders.Solid(FaceDir_PosZ, x, y, z) : chunk.Empty(x, y, z + 1))
+					AddFace(FaceDir_PosZ, x, y, z);
+
+				if (x <= 0 ? !borders.Solid(FaceDir_NegX, x, y, z) : chunk.Empty(x - 1, y, z))
+					AddFace(FaceDir_NegX, x, y, z);
+
+				if (x >= (dim - 1) ? !borders.Solid(FaceDir_PosX, x, y, z) : chunk.Empty(x + 1, y, z))
+					AddFace(FaceDir_PosX, x, y, z);
+
+				if (y <= 0 ? !borders.Solid(FaceDir_NegY, x, y, z) : chunk.Empty(x, y - 1, z))
+					AddFace(FaceDir_NegY, x, y, z);
+
+				if (y >= (dim - 1) ? !borders.Solid(FaceDir_PosY, x, y, z) : chunk.Empty(x, y + 1, z))
+					AddFace(FaceDir_PosY, x, y, z);
+			}
+		}
+	}
+}
+
+static void MeshChunkGreedy(const ChunkVoxels& chunk, const ChunkBorders& borders, u32 zBegin, u32 zEnd, MeshScratch& out)
+{
+	constexpr u32 dim = (u32)ChunkVoxels::dim;
+
+	// Material of the exposed faces for the slice currently being merged, indexed [v * dim + u]. Air where there is no
+	// face, only faces of the same material are merged.
+	VoxelMaterial mask[dim * dim];
+
+	// Range covered on each axis.
+	const u32 begin[3] = { 0, 0, zBegin };
+	const u32 end[3] = { dim, dim, zEnd };
+
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+	{
+		const u32 axis = dir / 2;
+		const bool positive = (dir & 1) != 0;
+
+		// The two axes spanning the face plane.
+		const u32 uAxis = (axis + 1) % 3;
+		const u32 vAxis = (axis + 2) % 3;
+
+		for (u32 slice = begin[axis]; slice < end[axis]; slice++)
+		{
+			const bool boundary = positive ? slice == dim - 1 : slice == 0;
+
+			for (u32 v = begin[vAxis]; v < end[vAxis]; v++)
+			{
+				for (u32 u = begin[uAxis]; u < end[uAxis]; u++)
+				{
+					u32 c[3];
+					c[axis] = slice;
+					c[uAxis] = u;
+					c[vAxis] = v;
+
+					const VoxelMaterial material = chunk.Material(c[0], c[1], c[2]);
+					bool exposed = material != VoxelMaterial_Air;
+
+					if (exposed && boundary)
+					{
+						exposed = !borders.Solid((FaceDir)dir, c[0], c[1], c[2]);
+					}
+					else if (exposed)
+					{
+						c[axis] = positive ? slice + 1 : slice - 1;
+						exposed = chunk.Empty(c[0], c[1], c[2]);
+					}
+
+					mask[v * dim + u] = exposed ? material : VoxelMaterial_Air;
+				}
+			}
+
+			for (u32 v = begin[vAxis]; v < end[vAxis]; v++)
+			{
+				for (u32 u = begin[uAxis]; u < end[uAxis]; )
+				{
+					const VoxelMaterial material = mask[v * dim + u];
+					if (material == VoxelMaterial_Air)
+					{
+						u++;
+						continue;
+					}
+
+					u32 width = 1;
+					while (u + width < end[uAxis] && mask[v * dim + u + width] == material)
+						width++;
+
+					u32 height = 1;
+					for (; v + height < end[vAxis]; height++)
+					{
+						bool rowFilled = true;
+						for (u32 i = 0; i < width && rowFilled; i++)
+							rowFilled = mask[(v + height) * dim + u + i] == material;
+
+						if (!rowFilled)
+							break;
+					}
+
+					for (u32 h = 0; h < height; h++)
+					{
+						for (u32 i = 0; i < width; i++)
+							mask[(v + h) * dim + u + i] = VoxelMaterial_Air;
+					}
+
+					u32 min[3], max[3];
+					min[axis] = max[axis] = slice;
+					min[uAxis] = u;
+					max[uAxis] = u + width - 1;
+					min[vAxis] = v;
+					max[vAxis] = v + height - 1;
+
+					EmitQuad(out, (FaceDir)dir, material, min, max);
+
+					u += width;
+				}
+			}
+		}
+	}
+}
+
+// Greedily merges a plane of face bits, one row of u bits per v, into rectangles. The plane is consumed.
+template<typename EmitFn>
+static void MergeFacePlane(u64* plane, u32 dim, EmitFn&& emit)
+{
+	for (u32 v = 0; v < dim; v++)
+	{
+		u64 bits = plane[v];
+
+		while (bits)
+		{
+			const u32 u = CountTrailingZeros64(bits);
+			const u32 width = Min(CountTrailingZeros64(~(bits >> u)), 64u - u);
+			const u64 run = (width == 64u ? ~0ull : ((1ull << width) - 1ull)) << u;
+
+			bits &= ~run;
+
+			u32 height = 1;
+			while (v + height < dim && (plane[v + height] & run) == run)
+			{
+				plane[v + height] &= ~run;
+				height++;
+			}
+
+			emit(u, v, width, height);
+		}
+	}
+}
+
+static void MeshChunkBinary(const ChunkVoxels& chunk, const ChunkBorders& borders, u32 zBegin, u32 zEnd, MeshScratch& out)
+{
+	constexpr u32 dim = (u32)ChunkVoxels::dim;
+	constexpr u64 rowMask = dim == 64 ? ~0ull : ((1ull << dim) - 1ull);
+
+	const u32 depth = zEnd - zBegin;
+	const ChunkVoxels::Row* rows = chunk.Rows();
+
+	// Exposed faces per direction, laid out like the chunk rows with one bit per x. Only rows in the range are filled.
+	u64 (*faces)[dim * dim] = out.faces.get();
+
+	ChunkVoxels::ForEachRowInSlices(zBegin, zEnd, [&](size_t i, u32 y, u32 z)
+	{
+		const u64 row = rows[i];
+
+		// The bits shifted in at either end of the row come from the X neighbours.
+		const u64 negXBorder = (u64)((borders.planes[FaceDir_NegX][z] >> y) & 1u);
+		const u64 posXBorder = (u64)((borders.planes[FaceDir_PosX][z] >> y) & 1u) << (dim - 1);
+
+		faces[FaceDir_NegX][i] = row & ~((row << 1) | negXBorder) & rowMask;
+		faces[FaceDir_PosX][i] = row & ~((row >> 1) | posXBorder);
+		faces[FaceDir_NegY][i] = row & ~(u64)(y > 0 ? rows[ChunkVoxels::RowIndex(y - 1, z)] : borders.planes[FaceDir_NegY][z]);
+		faces[FaceDir_PosY][i] = row & ~(u64)(y < dim - 1 ? rows[ChunkVoxels::RowIndex(y + 1, z)] : borders.planes[FaceDir_PosY][z]);
+		faces[FaceDir_NegZ][i] = row & ~(u64)(z > 0 ? rows[ChunkVoxels::RowIndex(y, z - 1)] : borders.planes[FaceDir_NegZ][y]);
+		faces[FaceDir_PosZ][i] = row & ~(u64)(z < dim - 1 ? rows[ChunkVoxels::RowIndex(y, z + 1)] : borders.planes[FaceDir_PosZ][y]);
+	});
+
+	// Faces are merged one material at a time. A chunk of a single material can use its occupancy as is.
+	assert(chunk.palette.size() <= k_MaxPaletteSize);
+	if (chunk.indexBits != 0)
+		chunk.GatherMaterialRows(zBegin, zEnd, out.materialRows.get());
+
+	u64 plane[dim];
+	u64 (*planes)[dim] = out.xPlanes.get();
+
+	for (u32 entry = 1; entry < (u32)chunk.palette.size(); entry++)
+	{
+		const VoxelMaterial material = chunk.palette[entry];
+		const ChunkVoxels::Row* materialRows = chunk.indexBits != 0 ? &out.materialRows[(size_t)entry * dim * dim] : rows;
+
+		// The exposed faces of this material.
+		auto Faces = [&](u32 dir, size_t i) { return faces[dir][i] & (u64)materialRows[i]; };
+
+		// +-X faces are perpendicular to the rows, so transpose each x slice into rows of y bits per z, relative to zBegin.
+		for (u32 dir = FaceDir_NegX; dir <= FaceDir_PosX; dir++)
+		{
+			// Only the slices being meshed are used.
+			for (u32 x = 0; x < dim; x++)
+				std::fill(planes[x], planes[x] + depth, 0ull);
+
+			for (u32 z = zBegin; z < zEnd; z++)
+			{
+				for (u32 y = 0; y < dim; y++)
+				{
+					u64 bits = Faces(dir, ChunkVoxels::RowIndex(y, z));
+					while (bits)
+					{
+						planes[CountTrailingZeros64(bits)][z - zBegin] |= 1ull << y;
+						bits &= bits - 1;
+					}
+				}
+			}
+
+			for (u32 x = 0; x < dim; x++)
+			{
+				MergeFacePlane(planes[x], depth, [&](u32 u, u32 v, u32 width, u32 height)
+				{
+					const u32 min[3] = { x, u, zBegin + v };
+					const u32 max[3] = { x, u + width - 1, zBegin + v + height - 1 };
+					EmitQuad(out, (FaceDir)dir, material, min, max);
+				});
+			}
+		}
+
+		// +-Y faces lie in the xz plane, gather the rows at this y for each z.
+		for (u32 dir = FaceDir_NegY; dir <= FaceDir_PosY; dir++)
+		{
+			for (u32 y = 0; y < dim; y++)
+			{
+				for (u32 z = zBegin; z < zEnd; z++)
+					plane[z - zBegin] = Faces(dir, ChunkVoxels::RowIndex(y, z));
+
+				MergeFacePlane(plane, depth, [&](u32 u, u32 v, u32 width, u32 height)
+				{
+					const u32 min[3] = { u, y, zBegin + v };
+					const u32 max[3] = { u + width - 1, y, zBegin + v + height - 1 };
+					EmitQuad(out, (FaceDir)dir, material, min, max);
+				});
+			}
+		}
+
+		// +-Z faces lie in the xy plane, the rows at this z are already contiguous.
+		for (u32 dir = FaceDir_NegZ; dir <= FaceDir_PosZ; dir++)
+		{
+			for (u32 z = zBegin; z < zEnd; z++)
+			{
+				for (u32 y = 0; y < dim; y++)
+					plane[y] = Faces(dir, ChunkVoxels::RowIndex(y, z));
+
+				MergeFacePlane(plane, dim, [&](u32 u, u32 v, u32 width, u32 height)
+				{
+					const u32 min[3] = { u, v, z };
+					const u32 max[3] = { u + width - 1, v + height - 1, z };
+					EmitQuad(out, (FaceDir)dir, material, min, max);
+				});
+			}
+		}
+	}
+}
+
+void MeshChunk(const ChunkVoxels& chunk, const ChunkBorders& borders, MeshingMode mode, u32 sectionMask, ChunkMeshData& out)
+{
+	MeshScratch& scratch = g_MeshScratch;
+	for (u32& count : scratch.vertexCount)
+		count = 0;
+
+	out.Clear();
+	out.sectionMask = sectionMask & k_AllChunkSections;
+
+	// A uniform chunk that is air or buried has no faces, no need to look at any voxels.
+	if (chunk.IsUniform() && (chunk.uniformMaterial == VoxelMaterial_Air || borders.AllSolid()))
+		return;
+
+	for (u32 section = 0; section < k_ChunkSectionCount; section++)
+	{
+		if ((out.sectionMask & (1u << section)) == 0)
+			continue;
+
+		const u32 zBegin = section * k_ChunkSectionSlices;
+		const u32 zEnd = zBegin + k_ChunkSectionSlices;
+
+		u32 firstVertex[FaceDir_Count];
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+			firstVertex[dir] = scratch.vertexCount[dir];
+
+		switch (mode)
+		{
+		case MeshingMode::Greedy:
+			MeshChunkGreedy(chunk, borders, zBegin, zEnd, scratch);
+			break;
+		case MeshingMode::Binary:
+			MeshChunkBinary(chunk, borders, zBegin, zEnd, scratch);
+			break;
+		case MeshingMode::PerFace:
+		default:
+			MeshChunkPerFace(chunk, borders, zBegin, zEnd, scratch);
+			break;
+		}
+
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+			out.rangeQuadCount[dir][section] = (scratch.vertexCount[dir] - firstVertex[dir]) / 4;
+	}
+
+	// Only allocates until out has grown to the largest mesh it has held.
+	for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		out.vertices.insert(out.vertices.end(), scratch.Face(dir), scratch.Face(dir) + scratch.vertexCount[dir]);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Chunk.h"
+
+#include <vector>
+
+// Occupancy of the slices of the adjacent chunks that touch this chunk, so faces between solid voxels either side of
+// a chunk border can be culled. Missing neighbours are left empty.
+struct ChunkBorders
+{
+	// Indexed by the direction of the neighbour. X neighbours store a row of y bits per z, Y neighbours a row of x bits
+	// per z and Z neighbours a row of x bits per y.
+	Chunk::Row planes[FaceDir_Count][Chunk::dim] = {};
+
+	// Is the voxel across the border in dir from the border voxel x, y, z solid.
+	bool Solid(FaceDir dir, u32 x, u32 y, u32 z) const
+	{
+		switch (dir)
+		{
+		case FaceDir_NegX:
+		case FaceDir_PosX:
+			return ((planes[dir][z] >> y) & 1u) != 0;
+		case FaceDir_NegY:
+		case FaceDir_PosY:
+			return ((planes[dir][z] >> x) & 1u) != 0;
+		default:
+			return ((planes[dir][y] >> x) & 1u) != 0;
+		}
+	}
+
+	// Every voxel across every border is solid, so a solid chunk inside them has no exposed faces.
+	bool AllSolid() const
+	{
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (Chunk::Row plane : planes[dir])
+			{
+				if (plane != ChunkVoxels::FullRow)
+					return false;
+			}
+		}
+		return true;
+	}
+};
+
+enum class MeshingMode : u8
+{
+	PerFace,	// One quad per exposed voxel face.
+	Greedy,		// Coplanar adjacent faces merged into maximal rectangles.
+	Binary,		// Greedy merging done on occupancy row bitmasks with shifts and bit scans.
+	COUNT,
+};
+
+const char* MeshingModeName(MeshingMode mode);
+
+// A chunk vertex packed into 32 bits, decoded by the vertex shader in Mesh.hlsl so the layouts must match.
+// Position is the chunk local voxel corner, 0 to Chunk::dim inclusive on each axis, the normal is the FaceDir and the
+// top byte is the VoxelMaterial.
+struct PackedVoxelVertex
+{
+	static constexpr u32 PositionBits = 7;
+	static constexpr u32 PositionMask = (1u << PositionBits) - 1u;
+	static constexpr u32 FaceShift = PositionBits * 3;
+	static constexpr u32 MaterialShift = 24;
+
+	static_assert(Chunk::dim <= PositionMask, "Chunk corners do not fit in PackedVoxelVertex::PositionBits");
+
+	u32 data;
+
+	static PackedVoxelVertex Pack(u32 x, u32 y, u32 z, FaceDir dir, VoxelMaterial material)
+	{
+		return { x | (y << PositionBits) | (z << (PositionBits * 2)) | ((u32)dir << FaceShift) | ((u32)material << MaterialShift) };
+	}
+
+	u32 Corner(u32 axis) const { return (data >> (PositionBits * axis)) & PositionMask; }
+	FaceDir Face() const { return (FaceDir)((data >> FaceShift) & 0x7u); }
+	VoxelMaterial Material() const { return (VoxelMaterial)(data >> MaterialShift); }
+};
+
+static_assert(sizeof(PackedVoxelVertex) == 4, "PackedVoxelVertex is bound as a single R32_UINT");
+
+// Worst case is a 3D checkerboard, half the voxels solid with all six faces exposed. Merging only ever reduces this.
+constexpr u32 k_MaxChunkQuads = (u32)(Chunk::dim * Chunk::dim * Chunk::dim / 2) * 6u;
+
+// CPU side output of the mesher, uploaded by Chunk::UploadMesh. Four vertices per quad, indexed by the shared
+// chunk quad index buffer. Only the sections in sectionMask were meshed, their quads are grouped by face direction
+// then section to match the layout of Mesh.
+struct ChunkMeshData
+{
+	std::vector<PackedVoxelVertex> vertices;
+	u32 sectionMask = 0;
+	u32 rangeQuadCount[FaceDir_Count][k_ChunkSectionCount] = {};
+
+	u32 QuadCount() const { return (u32)(vertices.size() / 4); }
+
+	void Clear()
+	{
+		vertices.clear();
+		sectionMask = 0;
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			for (u32& count : rangeQuadCount[dir])
+				count = 0;
+		}
+	}
+};
+
+// Gathered each frame so meshing modes can be compared on the same world.
+struct MeshingStats
+{
+	u32 chunksRebuilt = 0;		// Meshes swapped in this frame.
+	u32 chunksInFlight = 0;		// Being meshed or waiting on upload budget.
+	u32 chunksWaiting = 0;		// Dirty but not yet dispatched.
+	u32 meshingThreads = 0;
+	size_t vertexCount = 0;
+	size_t quadCount = 0;
+	double meshMilliseconds = 0.0;		// Summed over the worker jobs whose meshes were swapped in.
+	double uploadMilliseconds = 0.0;
+};
+
+// Meshes the sections in sectionMask. Quads are never merged across sections so each can be replaced on its own.
+// Safe to call from any thread, only reads voxels and borders. Meshes into per thread scratch storage then copies the
+// result into out, so reusing out between calls avoids any allocation once it has grown to the largest mesh.
+void MeshChunk(const ChunkVoxels& voxels, const ChunkBorders& borders, MeshingMode mode, u32 sectionMask, ChunkMeshData& out);
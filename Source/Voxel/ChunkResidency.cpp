@@ -0,0 +1,187 @@
+#include "ChunkResidency.h"
+
+#include "Surf/JobSystem.h"
+
+#include <algorithm>
+
+void ChunkResidency::Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, ResidencyStats* stats)
+{
+	frame++;
+
+	if (stats)
+		*stats = ResidencyStats();
+
+	AddCompleted(world, viewPosition, stats);
+	Load(jobs, viewPosition);
+	Evict(world, viewPosition, stats);
+
+	if (stats)
+	{
+		stats->evictedChunks = (u32)evicted.size();
+		stats->chunksLoading = inFlight;
+	}
+}
+
+float ChunkResidency::DistanceSq(const ChunkCoord& cc, const float3& viewPosition)
+{
+	const float halfChunk = Chunk::dim * VoxelSize * 0.5f - VoxelExtent;
+	const float dx = cc.coord.x * VoxelSize + halfChunk - viewPosition.x;
+	const float dy = cc.coord.y * VoxelSize + halfChunk - viewPosition.y;
+	const float dz = cc.coord.z * VoxelSize + halfChunk - viewPosition.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+void ChunkResidency::AddCompleted(VoxelWorld& world, const float3& viewPosition, ResidencyStats* stats)
+{
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		finished.insert(finished.end(), completed.begin(), completed.end());
+		completed.clear();
+	}
+
+	const float residentDistanceSq = residentDistance * residentDistance;
+
+	for (LoadJob* job : finished)
+	{
+		// Chunks forgotten while they were loading belong to a column that has gone, so they are dropped. Chunks the
+		// camera has moved away from go back to waiting rather than pushing the world over budget.
+		if (loading.erase(job->coord) != 0)
+		{
+			if (DistanceSq(job->coord, viewPosition) > residentDistanceSq)
+			{
+				evicted.insert(job->coord);
+			}
+			else
+			{
+				world.ReplaceChunk(job->coord, job->voxels);
+
+				if (stats)
+					stats->chunksLoaded++;
+			}
+		}
+
+		freeJobs.push_back(job);
+		inFlight--;
+	}
+
+	finished.clear();
+}
+
+void ChunkResidency::Load(JobSystem& jobs, const float3& viewPosition)
+{
+	const size_t freeSlots = maxJobsInFlight > inFlight ? maxJobsInFlight - inFlight : 0;
+	if (evicted.empty() || !loadChunk || freeSlots == 0)
+		return;
+
+	const float residentDistanceSq = residentDistance * residentDistance;
+
+	loads.clear();
+	for (const ChunkCoord& cc : evicted)
+	{
+		const float distanceSq = DistanceSq(cc, viewPosition);
+		if (distanceSq <= residentDistanceSq)
+			loads.push_back({ distanceSq, cc });
+	}
+
+	// Closest first, the rest wait for a later frame.
+	const size_t loadCount = Min(loads.size(), freeSlots);
+	std::partial_sort(loads.begin(), loads.begin() + loadCount, loads.end(),
+		[](const std::pair<float, ChunkCoord>& a, const std::pair<float, ChunkCoord>& b) { return a.first < b.first; });
+
+	for (size_t i = 0; i < loadCount; i++)
+	{
+		const ChunkCoord& cc = loads[i].second;
+
+		if (freeJobs.empty())
+		{
+			jobPool.push_back(std::make_unique<LoadJob>());
+			freeJobs.push_back(jobPool.back().get());
+		}
+
+		LoadJob* job = freeJobs.back();
+		freeJobs.pop_back();
+
+		job->coord = cc;
+
+		evicted.erase(cc);
+		loading.insert(cc);
+		inFlight++;
+
+		jobs.Submit([this, job]()
+		{
+			loadChunk(job->coord, job->voxels);
+
+			std::lock_guard<std::mutex> lock(completedMutex);
+			completed.push_back(job);
+		});
+	}
+}
+
+void ChunkResidency::Evict(VoxelWorld& world, const float3& viewPosition, ResidencyStats* stats)
+{
+	const float residentDistanceSq = residentDistance * residentDistance;
+
+	size_t cpuBytes = 0;
+	size_t gpuBytes = 0;
+	u32 residentChunks = 0;
+
+	candidates.clear();
+	for (ChunkMap::Entry& entry : world.chunks)
+	{
+		Chunk& chunk = entry.chunk;
+
+		const size_t chunkCpuBytes = chunk.CpuBytes();
+		const size_t chunkGpuBytes = chunk.GpuBytes();
+		cpuBytes += chunkCpuBytes;
+		gpuBytes += chunkGpuBytes;
+		residentChunks++;
+
+		const float distanceSq = DistanceSq(entry.coord, viewPosition);
+		if (distanceSq <= residentDistanceSq)
+			chunk.lastVisibleFrame = frame;
+		else if (!chunk.meshJobPending)
+			candidates.push_back({ entry.coord, chunk.lastVisibleFrame, distanceSq, chunkCpuBytes, chunkGpuBytes });
+	}
+
+	u32 chunksEvicted = 0;
+
+	if (cpuBytes > cpuBudgetBytes || gpuBytes > gpuBudgetBytes)
+	{
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{
+			if (a.lastVisibleFrame != b.lastVisibleFrame)
+				return a.lastVisibleFrame < b.lastVisibleFrame;
+
+			return a.distanceSq > b.distanceSq;
+		});
+
+		for (const Candidate& candidate : candidates)
+		{
+			if (cpuBytes <= cpuBudgetBytes && gpuBytes <= gpuBudgetBytes)
+				break;
+
+			// Only chunks taking up some of the budget that is over are worth evicting.
+			if ((cpuBytes <= cpuBudgetBytes || candidate.cpuBytes == 0) && (gpuBytes <= gpuBudgetBytes || candidate.gpuBytes == 0))
+				continue;
+
+			if (saveChunk)
+				saveChunk(candidate.coord, *world.FindChunk(candidate.coord));
+
+			world.RemoveChunk(candidate.coord);
+			evicted.insert(candidate.coord);
+
+			cpuBytes -= candidate.cpuBytes;
+			gpuBytes -= candidate.gpuBytes;
+			residentChunks--;
+			chunksEvicted++;
+		}
+	}
+
+	if (stats)
+	{
+		stats->residentChunks = residentChunks;
+		stats->chunksEvicted = chunksEvicted;
+		stats->cpuBytes = cpuBytes;
+		stats->gpuBytes = gpuBytes;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "VoxelWorld.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+class JobSystem;
+
+struct ResidencyStats
+{
+	u32 residentChunks = 0;
+	u32 evictedChunks = 0;		// Waiting to come back into range.
+	u32 chunksEvicted = 0;		// This frame.
+	u32 chunksLoaded = 0;		// This frame.
+	u32 chunksLoading = 0;		// In flight.
+	size_t cpuBytes = 0;
+	size_t gpuBytes = 0;
+};
+
+// Keeps the world within a memory budget. Chunks within residentDistance of the camera always stay, past that the
+// least recently visible are evicted first, furthest first between chunks last seen in the same frame, until the
+// world fits both budgets. Evicted chunks are remembered and loaded back on the job system once they come back into
+// range, then swapped into the world on the render thread.
+struct ChunkResidency
+{
+	size_t cpuBudgetBytes = 256u * 1024u * 1024u;
+	size_t gpuBudgetBytes = 256u * 1024u * 1024u;
+	float residentDistance = 256.0f;
+	u32 maxJobsInFlight = 16;
+
+	// Called with each chunk about to be evicted, to write out voxels that can't be regenerated. Optional.
+	std::function<void(const ChunkCoord& cc, const Chunk& chunk)> saveChunk;
+
+	// Called when an evicted chunk comes back into range to read back or regenerate its voxels. Called on the job
+	// threads.
+	std::function<void(const ChunkCoord& cc, ChunkVoxels& voxels)> loadChunk;
+
+	ChunkResidency() = default;
+	ChunkResidency(const ChunkResidency&) = delete;
+	ChunkResidency& operator=(const ChunkResidency&) = delete;
+
+	// Call once per frame on the render thread, before drawing.
+	void Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, ResidencyStats* stats = nullptr);
+
+	// Call for each chunk drawn this frame.
+	void MarkVisible(Chunk& chunk) const { chunk.lastVisibleFrame = frame; }
+
+	// Stops waiting to load an evicted chunk back, for chunks something else has unloaded for good.
+	void Forget(const ChunkCoord& cc)
+	{
+		evicted.erase(cc);
+		loading.erase(cc);
+	}
+
+	u32 InFlightCount() const { return inFlight; }
+
+private:
+	struct LoadJob
+	{
+		ChunkCoord coord;
+		ChunkVoxels voxels;
+	};
+
+	struct Candidate
+	{
+		ChunkCoord coord;
+		u32 lastVisibleFrame;
+		float distanceSq;
+		size_t cpuBytes;
+		size_t gpuBytes;
+	};
+
+	void AddCompleted(VoxelWorld& world, const float3& viewPosition, ResidencyStats* stats);
+	void Load(JobSystem& jobs, const float3& viewPosition);
+	void Evict(VoxelWorld& world, const float3& viewPosition, ResidencyStats* stats);
+
+	static float DistanceSq(const ChunkCoord& cc, const float3& viewPosition);
+
+	u32 frame = 0;
+
+	std::unordered_set<ChunkCoord, ChunkCoordHash> evicted;
+	std::vector<Candidate> candidates;
+	std::vector<std::pair<float, ChunkCoord>> loads;
+
+	// Chunks being loaded, taken out of evicted until they are swapped in.
+	std::unordered_set<ChunkCoord, ChunkCoordHash> loading;
+
+	// Written by the workers as jobs finish.
+	std::mutex completedMutex;
+	std::vector<LoadJob*> completed;
+
+	// Taken from completed on the render thread.
+	std::vector<LoadJob*> finished;
+
+	std::vector<std::unique_ptr<LoadJob>> jobPool;
+	std::vector<LoadJob*> freeJobs;
+	u32 inFlight = 0;
+};
@@ -0,0 +1,211 @@
+#include "ChunkStreamer.h"
+
+#include "Surf/JobSystem.h"
+
+#include <algorithm>
+
+void ChunkStreamer::Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, StreamingStats* stats)
+{
+	if (stats)
+		*stats = StreamingStats();
+
+	AddCompleted(world, viewPosition, stats);
+	Unload(world, viewPosition, stats);
+	Dispatch(jobs, viewPosition, viewDir, stats);
+
+	if (stats)
+	{
+		stats->loadedColumns = (u32)columns.size() - inFlight;
+		stats->columnsInFlight = inFlight;
+	}
+}
+
+float ChunkStreamer::ColumnDistanceSq(u32 x, u32 z, const float3& viewPosition)
+{
+	const float halfChunk = Chunk::dim * VoxelSize * 0.5f - VoxelExtent;
+	const float dx = x * VoxelSize + halfChunk - viewPosition.x;
+	const float dz = z * VoxelSize + halfChunk - viewPosition.z;
+	return dx * dx + dz * dz;
+}
+
+void ChunkStreamer::AddCompleted(VoxelWorld& world, const float3& viewPosition, StreamingStats* stats)
+{
+	{
+		std::lock_guard<std::mutex> lock(completedMutex);
+		finished.insert(finished.end(), completed.begin(), completed.end());
+		completed.clear();
+	}
+
+	const float unloadDistance = viewRadius + unloadMargin;
+
+	for (ColumnJob* job : finished)
+	{
+		VoxelColumn& column = job->column;
+
+		auto it = columns.find(ColumnKey(column.x, column.z));
+		assert(it != columns.end() && it->second.pending);
+
+		// The camera moved away while it was generating, don't add a column that would be unloaded straight away.
+		if (ColumnDistanceSq(column.x, column.z, viewPosition) > unloadDistance * unloadDistance)
+		{
+			columns.erase(it);
+			column.chunks.clear();
+		}
+		else
+		{
+			it->second.pending = false;
+			it->second.chunkCount = (u32)column.chunks.size();
+			world.AddColumn(column);
+
+			if (stats)
+				stats->columnsAdded++;
+		}
+
+		freeJobs.push_back(job);
+		inFlight--;
+	}
+
+	finished.clear();
+}
+
+void ChunkStreamer::Unload(VoxelWorld& world, const float3& viewPosition, StreamingStats* stats)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	const float unloadDistance = viewRadius + unloadMargin;
+	const float unloadDistanceSq = unloadDistance * unloadDistance;
+
+	unloads.clear();
+	for (const auto& pair : columns)
+	{
+		if (!pair.second.pending && ColumnDistanceSq((u32)(pair.first >> 32), (u32)pair.first, viewPosition) > unloadDistanceSq)
+			unloads.push_back(pair.first);
+	}
+
+	for (u64 key : unloads)
+	{
+		const u32 x = (u32)(key >> 32);
+		const u32 z = (u32)key;
+		// Edits and reloads can leave chunks above the generated ones, with gaps in between.
+		const u32 chunkCount = Max(columns[key].chunkCount, world.chunks.ColumnTop(x, z) / dim);
+
+		// Calls fn for every chunk coordinate of the column.
+		auto ForEachChunk = [&](auto&& fn)
+		{
+			for (u32 i = 0; i < chunkCount; i++)
+			{
+				const ChunkCoord cc(x, i * dim, z);
+				fn(cc, world.FindChunk(cc));
+			}
+		};
+
+		// Chunks being meshed can't be removed yet, leave the whole column for a later frame.
+		bool meshing = false;
+		ForEachChunk([&](const ChunkCoord&, Chunk* chunk) { meshing |= chunk && chunk->meshJobPending; });
+		if (meshing)
+			continue;
+
+		ForEachChunk([&](const ChunkCoord& cc, Chunk* chunk)
+		{
+			if (chunk)
+			{
+				if (saveChunk)
+					saveChunk(cc, *chunk);
+
+				// Dirties the faces the neighbouring columns share with it, which would otherwise keep meshing against
+				// voxels that are gone.
+				world.RemoveChunk(cc);
+			}
+
+			if (forgetChunk)
+				forgetChunk(cc);
+		});
+
+		columns.erase(key);
+
+		if (stats)
+			stats->columnsUnloaded++;
+	}
+}
+
+void ChunkStreamer::Dispatch(JobSystem& jobs, const float3& viewPosition, const float3& viewDir, StreamingStats* stats)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+	constexpr float columnExtent = dim * VoxelSize * 0.5f;
+	constexpr float columnRadius = columnExtent * 1.4142136f;
+
+	if (!generateColumn)
+		return;
+
+	// The columns under the square around the radius. Voxel coordinates are unsigned, so the world stops at zero and
+	// just short of the top of the range.
+	const float reach = viewRadius / VoxelSize;
+	const float maxCoord = 4.0e9f;
+	const u32 minX = (u32)Clamp(viewPosition.x / VoxelSize - reach, 0.0f, maxCoord) & CHUNK_MASK;
+	const u32 maxX = (u32)Clamp(viewPosition.x / VoxelSize + reach, 0.0f, maxCoord);
+	const u32 minZ = (u32)Clamp(viewPosition.z / VoxelSize - reach, 0.0f, maxCoord) & CHUNK_MASK;
+	const u32 maxZ = (u32)Clamp(viewPosition.z / VoxelSize + reach, 0.0f, maxCoord);
+
+	const float viewRadiusSq = viewRadius * viewRadius;
+
+	candidates.clear();
+
+	for (u32 z = minZ; z <= maxZ; z += dim)
+	{
+		for (u32 x = minX; x <= maxX; x += dim)
+		{
+			const float distanceSq = ColumnDistanceSq(x, z, viewPosition);
+			if (distanceSq > viewRadiusSq || columns.count(ColumnKey(x, z)))
+				continue;
+
+			const float3 toColumn = float3(x * VoxelSize + columnExtent - VoxelExtent - viewPosition.x, 0.0f, z * VoxelSize + columnExtent - VoxelExtent - viewPosition.z);
+
+			// Columns behind the camera can't be seen until it turns, so let everything in front go first.
+			float priority = distanceSq;
+			if (DotF3(toColumn, viewDir) < -columnRadius)
+				priority *= 4.0f;
+
+			candidates.push_back({ x, z, priority });
+		}
+	}
+
+	const size_t freeSlots = maxJobsInFlight > inFlight ? maxJobsInFlight - inFlight : 0;
+	const size_t dispatchCount = Min(freeSlots, candidates.size());
+
+	if (stats)
+		stats->columnsWaiting = (u32)(candidates.size() - dispatchCount);
+
+	if (dispatchCount == 0)
+		return;
+
+	std::partial_sort(candidates.begin(), candidates.begin() + dispatchCount, candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority < b.priority; });
+
+	for (size_t i = 0; i < dispatchCount; i++)
+	{
+		const Candidate& candidate = candidates[i];
+
+		if (freeJobs.empty())
+		{
+			jobPool.push_back(std::make_unique<ColumnJob>());
+			freeJobs.push_back(jobPool.back().get());
+		}
+
+		ColumnJob* job = freeJobs.back();
+		freeJobs.pop_back();
+
+		job->column.x = candidate.x;
+		job->column.z = candidate.z;
+		job->column.chunks.clear();
+
+		columns[ColumnKey(candidate.x, candidate.z)].pending = true;
+		inFlight++;
+
+		jobs.Submit([this, job]()
+		{
+			generateColumn(job->column);
+
+			std::lock_guard<std::mutex> lock(completedMutex);
+			completed.push_back(job);
+		});
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "VoxelWorld.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class JobSystem;
+
+struct StreamingStats
+{
+	u32 loadedColumns = 0;
+	u32 columnsInFlight = 0;
+	u32 columnsWaiting = 0;		// In range but not dispatched yet.
+	u32 columnsAdded = 0;		// This frame.
+	u32 columnsUnloaded = 0;	// This frame.
+};
+
+// Generates the world on demand, one chunk column at a time, within viewRadius of the camera across x and z. Columns
+// are filled on the job system and added to the world on the render thread, closest to the camera first with columns
+// behind it pushed back. Columns further than viewRadius + unloadMargin are unloaded again, so memory follows the view
+// radius rather than how much of the world has been visited. The columns next to an unloaded one are remeshed with air
+// across its border.
+struct ChunkStreamer
+{
+	float viewRadius = 256.0f;
+
+	// Extra distance a column has to move out before it is unloaded, so wandering along the edge of the radius doesn't
+	// load and unload the same columns every frame.
+	float unloadMargin = 32.0f;
+
+	u32 maxJobsInFlight = 8;
+
+	// Fills column.chunks for the column at column.x, column.z. Called on the job threads.
+	std::function<void(VoxelColumn& column)> generateColumn;
+
+	// Called with each chunk of a column about to be unloaded, to write out voxels that can't be regenerated. Optional.
+	std::function<void(const ChunkCoord& cc, const Chunk& chunk)> saveChunk;
+
+	// Called with every chunk coordinate an unloaded column covered, including chunks already removed by something
+	// else, so they can be forgotten. Optional.
+	std::function<void(const ChunkCoord& cc)> forgetChunk;
+
+	ChunkStreamer() = default;
+	ChunkStreamer(const ChunkStreamer&) = delete;
+	ChunkStreamer& operator=(const ChunkStreamer&) = delete;
+
+	// Call once per frame on the render thread, before the mesh scheduler.
+	void Update(VoxelWorld& world, JobSystem& jobs, const float3& viewPosition, const float3& viewDir, StreamingStats* stats = nullptr);
+
+	u32 InFlightCount() const { return inFlight; }
+
+private:
+	struct ColumnJob
+	{
+		VoxelColumn column;
+	};
+
+	struct LoadedColumn
+	{
+		u32 chunkCount = 0;
+		bool pending = false;
+	};
+
+	struct Candidate
+	{
+		u32 x;
+		u32 z;
+		float priority;
+	};
+
+	static u64 ColumnKey(u32 x, u32 z) { return ((u64)x << 32) | z; }
+	static float ColumnDistanceSq(u32 x, u32 z, const float3& viewPosition);
+
+	void AddCompleted(VoxelWorld& world, const float3& viewPosition, StreamingStats* stats);
+	void Unload(VoxelWorld& world, const float3& viewPosition, StreamingStats* stats);
+	void Dispatch(JobSystem& jobs, const float3& viewPosition, const float3& viewDir, StreamingStats* stats);
+
+	// Loaded and pending columns, keyed by their corner with x in the high bits.
+	std::unordered_map<u64, LoadedColumn> columns;
+
+	// Written by the workers as jobs finish.
+	std::mutex completedMutex;
+	std::vector<ColumnJob*> completed;
+
+	// Taken from completed on the render thread.
+	std::vector<ColumnJob*> finished;
+
+	std::vector<std::unique_ptr<ColumnJob>> jobPool;
+	std::vector<ColumnJob*> freeJobs;
+	std::vector<Candidate> candidates;
+	std::vector<u64> unloads;
+	u32 inFlight = 0;
+};
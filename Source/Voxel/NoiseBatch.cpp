@@ -0,0 +1,643 @@
+#include "NoiseBatch.h"
+
+#include "ThirdParty/FastNoiseLite/FastNoistLite.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define NOISE_BATCH_SSE2 1
+#include <emmintrin.h>
+#else
+#define NOISE_BATCH_SSE2 0
+#endif
+
+// MSVC compiles AVX2 intrinsics whatever the target architecture, so the AVX2 path is always built and picked at
+// runtime. Other compilers only build it when targeting AVX2.
+#if NOISE_BATCH_SSE2 && (defined(_MSC_VER) || defined(__AVX2__))
+#define NOISE_BATCH_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define NOISE_BATCH_AVX2 0
+#endif
+
+struct NoiseBatchSettings
+{
+	i32 seed;
+	float frequency;
+	FastNoiseLite::FractalType fractalType;
+	i32 octaves;
+	float lacunarity;
+	float gain;
+	float weightedStrength;
+	float fractalBounding;
+	i32 transformType3D;
+	i32 primeX;
+	i32 primeY;
+	i32 primeZ;
+	const float* gradients2D;
+	const float* gradients3D;
+};
+
+// The 3D coordinate transforms, in the order of FastNoiseLite::TransformType3D.
+enum NoiseTransform3D
+{
+	NoiseTransform3D_None,
+	NoiseTransform3D_ImproveXYPlanes,
+	NoiseTransform3D_ImproveXZPlanes,
+	NoiseTransform3D_DefaultOpenSimplex2,
+};
+
+bool NoiseBatch::GetSettings(const FastNoiseLite& noise, NoiseBatchSettings& settings)
+{
+	if (noise.mNoiseType != FastNoiseLite::NoiseType_OpenSimplex2)
+		return false;
+
+	if (noise.mFractalType != FastNoiseLite::FractalType_None && noise.mFractalType != FastNoiseLite::FractalType_FBm &&
+		noise.mFractalType != FastNoiseLite::FractalType_Ridged)
+		return false;
+
+	settings.seed = noise.mSeed;
+	settings.frequency = noise.mFrequency;
+	settings.fractalType = noise.mFractalType;
+	settings.octaves = noise.mOctaves;
+	settings.lacunarity = noise.mLacunarity;
+	settings.gain = noise.mGain;
+	settings.weightedStrength = noise.mWeightedStrength;
+	settings.fractalBounding = noise.mFractalBounding;
+	settings.transformType3D = (i32)noise.mTransformType3D;
+	settings.primeX = FastNoiseLite::PrimeX;
+	settings.primeY = FastNoiseLite::PrimeY;
+	settings.primeZ = FastNoiseLite::PrimeZ;
+	settings.gradients2D = FastNoiseLite::Lookup<float>::Gradients2D;
+	settings.gradients3D = FastNoiseLite::Lookup<float>::Gradients3D;
+	return true;
+}
+
+#if NOISE_BATCH_SSE2
+
+// Each lane set wraps the intrinsics for one register width, so the noise is written once as a template over them.
+// Masks are floats with every bit set in true lanes.
+
+struct LanesSSE2
+{
+	typedef __m128 F;
+	typedef __m128i I;
+	static const u32 Width = 4;
+
+	static F Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, F v) { _mm_storeu_ps(p, v); }
+	static F Set(float f) { return _mm_set1_ps(f); }
+	static I SetI(i32 i) { return _mm_set1_epi32(i); }
+
+	static F Add(F a, F b) { return _mm_add_ps(a, b); }
+	static F Sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F Mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F Min(F a, F b) { return _mm_min_ps(a, b); }
+	static F Abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static F Negate(F a) { return _mm_xor_ps(_mm_set1_ps(-0.0f), a); }
+
+	static F Less(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static F LessEqual(F a, F b) { return _mm_cmple_ps(a, b); }
+	static F And(F a, F b) { return _mm_and_ps(a, b); }
+	static F Or(F a, F b) { return _mm_or_ps(a, b); }
+	static F AndNot(F mask, F a) { return _mm_andnot_ps(mask, a); }
+	static F Select(F mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	static I AddI(I a, I b) { return _mm_add_epi32(a, b); }
+	static I SubI(I a, I b) { return _mm_sub_epi32(a, b); }
+	static I XorI(I a, I b) { return _mm_xor_si128(a, b); }
+	static I AndI(I a, I b) { return _mm_and_si128(a, b); }
+	static I OrI(I a, I b) { return _mm_or_si128(a, b); }
+	static I SelectI(F mask, I a, I b) { return _mm_castps_si128(Select(mask, _mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+	template<int Shift> static I ShiftRightI(I a) { return _mm_srai_epi32(a, Shift); }
+
+	// SSE2 only multiplies the even lanes, so multiply the odd ones separately and interleave the low halves.
+	static I MulI(I a, I b)
+	{
+		const __m128i even = _mm_mul_epu32(a, b);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	static I Truncate(F a) { return _mm_cvttps_epi32(a); }
+	static F ToFloat(I a) { return _mm_cvtepi32_ps(a); }
+	static I MaskToInt(F mask) { return _mm_castps_si128(mask); }
+
+	static F Gather(const float* table, I index)
+	{
+		alignas(16) i32 indices[Width];
+		_mm_store_si128((__m128i*)indices, index);
+		return _mm_setr_ps(table[indices[0]], table[indices[1]], table[indices[2]], table[indices[3]]);
+	}
+};
+
+#if NOISE_BATCH_AVX2
+
+struct LanesAVX2
+{
+	typedef __m256 F;
+	typedef __m256i I;
+	static const u32 Width = 8;
+
+	static F Load(const float* p) { return _mm256_loadu_ps(p); }
+	static void Store(float* p, F v) { _mm256_storeu_ps(p, v); }
+	static F Set(float f) { return _mm256_set1_ps(f); }
+	static I SetI(i32 i) { return _mm256_set1_epi32(i); }
+
+	static F Add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F Sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F Mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F Min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F Abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static F Negate(F a) { return _mm256_xor_ps(_mm256_set1_ps(-0.0f), a); }
+
+	static F Less(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static F LessEqual(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static F And(F a, F b) { return _mm256_and_ps(a, b); }
+	static F Or(F a, F b) { return _mm256_or_ps(a, b); }
+	static F AndNot(F mask, F a) { return _mm256_andnot_ps(mask, a); }
+	static F Select(F mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+
+	static I AddI(I a, I b) { return _mm256_add_epi32(a, b); }
+	static I SubI(I a, I b) { return _mm256_sub_epi32(a, b); }
+	static I XorI(I a, I b) { return _mm256_xor_si256(a, b); }
+	static I AndI(I a, I b) { return _mm256_and_si256(a, b); }
+	static I OrI(I a, I b) { return _mm256_or_si256(a, b); }
+	static I SelectI(F mask, I a, I b) { return _mm256_castps_si256(Select(mask, _mm256_castsi256_ps(a), _mm256_castsi256_ps(b))); }
+	template<int Shift> static I ShiftRightI(I a) { return _mm256_srai_epi32(a, Shift); }
+	static I MulI(I a, I b) { return _mm256_mullo_epi32(a, b); }
+
+	static I Truncate(F a) { return _mm256_cvttps_epi32(a); }
+	static F ToFloat(I a) { return _mm256_cvtepi32_ps(a); }
+	static I MaskToInt(F mask) { return _mm256_castps_si256(mask); }
+
+	static F Gather(const float* table, I index) { return _mm256_i32gather_ps(table, index, 4); }
+};
+
+static bool CpuHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS has to save the AVX registers too.
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool g_NoiseBatchAVX2 = CpuHasAVX2();
+
+#endif
+
+// The scalar code mixes int and float in places, each step below is written to round exactly as it does.
+
+template<typename L>
+static typename L::I HashLanes(i32 seed, typename L::I xPrimed, typename L::I yPrimed)
+{
+	const typename L::I hash = L::XorI(L::XorI(L::SetI(seed), xPrimed), yPrimed);
+	return L::MulI(hash, L::SetI(0x27d4eb2d));
+}
+
+template<typename L>
+static typename L::F GradCoord2D(const NoiseBatchSettings& s, i32 seed, typename L::I xPrimed, typename L::I yPrimed, typename L::F xd, typename L::F yd)
+{
+	typename L::I hash = HashLanes<L>(seed, xPrimed, yPrimed);
+	hash = L::XorI(hash, L::template ShiftRightI<15>(hash));
+	hash = L::AndI(hash, L::SetI(127 << 1));
+
+	const typename L::F xg = L::Gather(s.gradients2D, hash);
+	const typename L::F yg = L::Gather(s.gradients2D, L::OrI(hash, L::SetI(1)));
+	return L::Add(L::Mul(xd, xg), L::Mul(yd, yg));
+}
+
+template<typename L>
+static typename L::F GradCoord3D(const NoiseBatchSettings& s, i32 seed, typename L::I xPrimed, typename L::I yPrimed, typename L::I zPrimed,
+	typename L::F xd, typename L::F yd, typename L::F zd)
+{
+	typename L::I hash = L::MulI(L::XorI(L::XorI(L::XorI(L::SetI(seed), xPrimed), yPrimed), zPrimed), L::SetI(0x27d4eb2d));
+	hash = L::XorI(hash, L::template ShiftRightI<15>(hash));
+	hash = L::AndI(hash, L::SetI(63 << 2));
+
+	const typename L::F xg = L::Gather(s.gradients3D, hash);
+	const typename L::F yg = L::Gather(s.gradients3D, L::OrI(hash, L::SetI(1)));
+	const typename L::F zg = L::Gather(s.gradients3D, L::OrI(hash, L::SetI(2)));
+	return L::Add(L::Add(L::Mul(xd, xg), L::Mul(yd, yg)), L::Mul(zd, zg));
+}
+
+// (a * a) * (a * a) * grad where a is positive, zero elsewhere.
+template<typename L>
+static typename L::F Falloff(typename L::F a, typename L::F grad)
+{
+	const typename L::F a2 = L::Mul(a, a);
+	const typename L::F value = L::Mul(L::Mul(a2, a2), grad);
+	return L::AndNot(L::LessEqual(a, L::Set(0.0f)), value);
+}
+
+// FastNoiseLite::SingleSimplex, on coordinates already skewed.
+template<typename L>
+static typename L::F OpenSimplex2Lanes(const NoiseBatchSettings& s, i32 seed, typename L::F x, typename L::F y)
+{
+	typedef typename L::F F;
+	typedef typename L::I I;
+
+	const float SQRT3 = 1.7320508075688772935274463415059f;
+	const float G2 = (3 - SQRT3) / 6;
+
+	// FastFloor rounds towards zero then steps down for every negative value, whole numbers included.
+	const F zero = L::Set(0.0f);
+	I i = L::AddI(L::Truncate(x), L::MaskToInt(L::Less(x, zero)));
+	I j = L::AddI(L::Truncate(y), L::MaskToInt(L::Less(y, zero)));
+	const F xi = L::Sub(x, L::ToFloat(i));
+	const F yi = L::Sub(y, L::ToFloat(j));
+
+	const F t = L::Mul(L::Add(xi, yi), L::Set(G2));
+	const F x0 = L::Sub(xi, t);
+	const F y0 = L::Sub(yi, t);
+
+	i = L::MulI(i, L::SetI(s.primeX));
+	j = L::MulI(j, L::SetI(s.primeY));
+
+	const F a = L::Sub(L::Sub(L::Set(0.5f), L::Mul(x0, x0)), L::Mul(y0, y0));
+	const F n0 = Falloff<L>(a, GradCoord2D<L>(s, seed, i, j, x0, y0));
+
+	const F c = L::Add(L::Mul(L::Set((float)(2 * (1 - 2 * G2) * (1 / G2 - 2))), t), L::Add(L::Set((float)(-2 * (1 - 2 * G2) * (1 - 2 * G2))), a));
+	const F x2 = L::Add(x0, L::Set(2 * (float)G2 - 1));
+	const F y2 = L::Add(y0, L::Set(2 * (float)G2 - 1));
+	const I iPlus = L::AddI(i, L::SetI(s.primeX));
+	const I jPlus = L::AddI(j, L::SetI(s.primeY));
+	const F n2 = Falloff<L>(c, GradCoord2D<L>(s, seed, iPlus, jPlus, x2, y2));
+
+	// The middle corner steps along y if the point is above the diagonal, otherwise along x.
+	const F upper = L::Less(x0, y0);
+	const F x1 = L::Add(x0, L::Select(upper, L::Set((float)G2), L::Set((float)G2 - 1)));
+	const F y1 = L::Add(y0, L::Select(upper, L::Set((float)G2 - 1), L::Set((float)G2)));
+	const I i1 = L::SelectI(upper, i, iPlus);
+	const I j1 = L::SelectI(upper, jPlus, j);
+	const F b = L::Sub(L::Sub(L::Set(0.5f), L::Mul(x1, x1)), L::Mul(y1, y1));
+	const F n1 = Falloff<L>(b, GradCoord2D<L>(s, seed, i1, j1, x1, y1));
+
+	return L::Mul(L::Add(L::Add(n0, n1), n2), L::Set(99.83685446303647f));
+}
+
+// FastNoiseLite::SingleOpenSimplex2 in 3D, on coordinates already transformed.
+template<typename L>
+static typename L::F OpenSimplex2Lanes(const NoiseBatchSettings& s, i32 seed, typename L::F x, typename L::F y, typename L::F z)
+{
+	typedef typename L::F F;
+	typedef typename L::I I;
+
+	// FastRound rounds half away from zero.
+	const F zero = L::Set(0.0f);
+	const F half = L::Set(0.5f);
+	const F minusHalf = L::Set(-0.5f);
+	I i = L::Truncate(L::Add(x, L::Select(L::Less(x, zero), minusHalf, half)));
+	I j = L::Truncate(L::Add(y, L::Select(L::Less(y, zero), minusHalf, half)));
+	I k = L::Truncate(L::Add(z, L::Select(L::Less(z, zero), minusHalf, half)));
+	F x0 = L::Sub(x, L::ToFloat(i));
+	F y0 = L::Sub(y, L::ToFloat(j));
+	F z0 = L::Sub(z, L::ToFloat(k));
+
+	const F minusOne = L::Set(-1.0f);
+	const I one = L::SetI(1);
+	I xNSign = L::OrI(L::Truncate(L::Sub(minusOne, x0)), one);
+	I yNSign = L::OrI(L::Truncate(L::Sub(minusOne, y0)), one);
+	I zNSign = L::OrI(L::Truncate(L::Sub(minusOne, z0)), one);
+
+	F ax0 = L::Mul(L::ToFloat(xNSign), L::Negate(x0));
+	F ay0 = L::Mul(L::ToFloat(yNSign), L::Negate(y0));
+	F az0 = L::Mul(L::ToFloat(zNSign), L::Negate(z0));
+
+	const I primeX = L::SetI(s.primeX);
+	const I primeY = L::SetI(s.primeY);
+	const I primeZ = L::SetI(s.primeZ);
+	i = L::MulI(i, primeX);
+	j = L::MulI(j, primeY);
+	k = L::MulI(k, primeZ);
+
+	F value = zero;
+	F a = L::Sub(L::Sub(L::Set(0.6f), L::Mul(x0, x0)), L::Add(L::Mul(y0, y0), L::Mul(z0, z0)));
+
+	for (u32 l = 0; ; l++)
+	{
+		value = L::Add(value, Falloff<L>(a, GradCoord3D<L>(s, seed, i, j, k, x0, y0, z0)));
+
+		// Step to the next closest corner along whichever axis the point is furthest along, x winning ties and then y.
+		const F notX = L::Or(L::Less(ax0, ay0), L::Less(ax0, az0));
+		const F yFurthest = L::AndNot(L::Less(ay0, az0), L::Less(ax0, ay0));
+		const F zFurthest = L::AndNot(yFurthest, notX);
+
+		const F xSign = L::ToFloat(xNSign);
+		const F ySign = L::ToFloat(yNSign);
+		const F zSign = L::ToFloat(zNSign);
+
+		const F x1 = L::Select(notX, x0, L::Add(x0, xSign));
+		const F y1 = L::Select(yFurthest, L::Add(y0, ySign), y0);
+		const F z1 = L::Select(zFurthest, L::Add(z0, zSign), z0);
+
+		const F two = L::Set(2.0f);
+		F b = L::Add(a, L::Set(1.0f));
+		b = L::Select(notX, b, L::Sub(b, L::Mul(L::Mul(xSign, two), x1)));
+		b = L::Select(yFurthest, L::Sub(b, L::Mul(L::Mul(ySign, two), y1)), b);
+		b = L::Select(zFurthest, L::Sub(b, L::Mul(L::Mul(zSign, two), z1)), b);
+
+		const I i1 = L::SelectI(notX, i, L::SubI(i, L::MulI(xNSign, primeX)));
+		const I j1 = L::SelectI(yFurthest, L::SubI(j, L::MulI(yNSign, primeY)), j);
+		const I k1 = L::SelectI(zFurthest, L::SubI(k, L::MulI(zNSign, primeZ)), k);
+
+		value = L::Add(value, Falloff<L>(b, GradCoord3D<L>(s, seed, i1, j1, k1, x1, y1, z1)));
+
+		if (l == 1)
+			break;
+
+		ax0 = L::Sub(half, ax0);
+		ay0 = L::Sub(half, ay0);
+		az0 = L::Sub(half, az0);
+
+		x0 = L::Mul(xSign, ax0);
+		y0 = L::Mul(ySign, ay0);
+		z0 = L::Mul(zSign, az0);
+
+		a = L::Add(a, L::Sub(L::Sub(L::Set(0.75f), ax0), L::Add(ay0, az0)));
+
+		i = L::AddI(i, L::AndI(L::template ShiftRightI<1>(xNSign), primeX));
+		j = L::AddI(j, L::AndI(L::template ShiftRightI<1>(yNSign), primeY));
+		k = L::AddI(k, L::AndI(L::template ShiftRightI<1>(zNSign), primeZ));
+
+		xNSign = L::SubI(L::SetI(0), xNSign);
+		yNSign = L::SubI(L::SetI(0), yNSign);
+		zNSign = L::SubI(L::SetI(0), zNSign);
+
+		seed = ~seed;
+	}
+
+	return L::Mul(value, L::Set(32.69428253173828125f));
+}
+
+// Runs the fractal on top of single noise, noise(seed, scale) evaluating one octave with the coordinates scaled.
+template<typename L, typename NoiseFn>
+static typename L::F FractalLanes(const NoiseBatchSettings& s, NoiseFn&& noise)
+{
+	typedef typename L::F F;
+
+	if (s.fractalType == FastNoiseLite::FractalType_None)
+		return noise(s.seed, 0);
+
+	const F one = L::Set(1.0f);
+	const F weightedStrength = L::Set(s.weightedStrength);
+
+	F sum = L::Set(0.0f);
+	F amp = L::Set(s.fractalBounding);
+	for (i32 octave = 0; octave < s.octaves; octave++)
+	{
+		F value = noise(s.seed + octave, octave);
+		F weight;
+		if (s.fractalType == FastNoiseLite::FractalType_FBm)
+		{
+			sum = L::Add(sum, L::Mul(value, amp));
+			weight = L::Mul(L::Min(L::Add(value, one), L::Set(2.0f)), L::Set(0.5f));
+		}
+		else
+		{
+			value = L::Abs(value);
+			sum = L::Add(sum, L::Mul(L::Add(L::Mul(value, L::Set(-2.0f)), one), amp));
+			weight = L::Sub(one, value);
+		}
+
+		amp = L::Mul(amp, L::Add(one, L::Mul(weightedStrength, L::Sub(weight, one))));
+		amp = L::Mul(amp, L::Set(s.gain));
+	}
+
+	return sum;
+}
+
+template<typename L>
+static void NoiseLanes(const NoiseBatchSettings& s, const float* xs, const float* ys, float* out)
+{
+	typedef typename L::F F;
+
+	const F frequency = L::Set(s.frequency);
+	F x = L::Mul(L::Load(xs), frequency);
+	F y = L::Mul(L::Load(ys), frequency);
+
+	const float SQRT3 = (float)1.7320508075688772935274463415059;
+	const float F2 = 0.5f * (SQRT3 - 1);
+	const F t = L::Mul(L::Add(x, y), L::Set(F2));
+	x = L::Add(x, t);
+	y = L::Add(y, t);
+
+	// The coordinates scale by lacunarity once per octave, so keep the running product rather than recomputing it.
+	const F lacunarity = L::Set(s.lacunarity);
+	L::Store(out, FractalLanes<L>(s, [&](i32 seed, i32)
+	{
+		const F value = OpenSimplex2Lanes<L>(s, seed, x, y);
+		x = L::Mul(x, lacunarity);
+		y = L::Mul(y, lacunarity);
+		return value;
+	}));
+}
+
+template<typename L>
+static void NoiseLanes(const NoiseBatchSettings& s, const float* xs, const float* ys, const float* zs, float* out)
+{
+	typedef typename L::F F;
+
+	const F frequency = L::Set(s.frequency);
+	F x = L::Mul(L::Load(xs), frequency);
+	F y = L::Mul(L::Load(ys), frequency);
+	F z = L::Mul(L::Load(zs), frequency);
+
+	switch (s.transformType3D)
+	{
+	case NoiseTransform3D_ImproveXYPlanes:
+	{
+		const F xy = L::Add(x, y);
+		const F s2 = L::Mul(xy, L::Set(-(float)0.211324865405187));
+		z = L::Mul(z, L::Set((float)0.577350269189626));
+		x = L::Add(x, L::Sub(s2, z));
+		y = L::Sub(L::Add(y, s2), z);
+		z = L::Add(z, L::Mul(xy, L::Set((float)0.577350269189626)));
+		break;
+	}
+	case NoiseTransform3D_ImproveXZPlanes:
+	{
+		const F xz = L::Add(x, z);
+		const F s2 = L::Mul(xz, L::Set(-(float)0.211324865405187));
+		y = L::Mul(y, L::Set((float)0.577350269189626));
+		x = L::Add(x, L::Sub(s2, y));
+		z = L::Add(z, L::Sub(s2, y));
+		y = L::Add(y, L::Mul(xz, L::Set((float)0.577350269189626)));
+		break;
+	}
+	case NoiseTransform3D_DefaultOpenSimplex2:
+	{
+		const F r = L::Mul(L::Add(L::Add(x, y), z), L::Set((float)(2.0 / 3.0)));
+		x = L::Sub(r, x);
+		y = L::Sub(r, y);
+		z = L::Sub(r, z);
+		break;
+	}
+	default:
+		break;
+	}
+
+	const F lacunarity = L::Set(s.lacunarity);
+	L::Store(out, FractalLanes<L>(s, [&](i32 seed, i32)
+	{
+		const F value = OpenSimplex2Lanes<L>(s, seed, x, y, z);
+		x = L::Mul(x, lacunarity);
+		y = L::Mul(y, lacunarity);
+		z = L::Mul(z, lacunarity);
+		return value;
+	}));
+}
+
+// Runs fn(first) for each full set of lanes, then once more on copies padded out to a full set for any left over.
+template<typename L, typename Fn>
+static void ForEachLaneSet(size_t count, u32 streams, const float* const* in, float* out, Fn&& fn)
+{
+	size_t i = 0;
+	for (; i + L::Width <= count; i += L::Width)
+	{
+		const float* lanes[3] = { in[0] + i, in[1] + i, streams > 2 ? in[2] + i : nullptr };
+		fn(lanes, out + i);
+	}
+
+	if (i == count)
+		return;
+
+	float padded[3][L::Width] = {};
+	float paddedOut[L::Width];
+	for (u32 stream = 0; stream < streams; stream++)
+	{
+		for (size_t lane = 0; lane < count - i; lane++)
+			padded[stream][lane] = in[stream][i + lane];
+	}
+
+	const float* lanes[3] = { padded[0], padded[1], padded[2] };
+	fn(lanes, paddedOut);
+
+	for (size_t lane = 0; lane < count - i; lane++)
+		out[i + lane] = paddedOut[lane];
+}
+
+template<typename L>
+static void NoiseBatch2D(const NoiseBatchSettings& s, const float* xs, const float* ys, float* out, size_t count)
+{
+	const float* in[2] = { xs, ys };
+	ForEachLaneSet<L>(count, 2, in, out, [&](const float* const* lanes, float* laneOut) { NoiseLanes<L>(s, lanes[0], lanes[1], laneOut); });
+}
+
+template<typename L>
+static void NoiseBatch3D(const NoiseBatchSettings& s, const float* xs, const float* ys, const float* zs, float* out, size_t count)
+{
+	const float* in[3] = { xs, ys, zs };
+	ForEachLaneSet<L>(count, 3, in, out, [&](const float* const* lanes, float* laneOut) { NoiseLanes<L>(s, lanes[0], lanes[1], lanes[2], laneOut); });
+}
+
+#endif
+
+void NoiseBatch::GetNoise(const FastNoiseLite& noise, const float* xs, const float* ys, float* out, size_t count)
+{
+#if NOISE_BATCH_SSE2
+	NoiseBatchSettings settings;
+	if (GetSettings(noise, settings))
+	{
+#if NOISE_BATCH_AVX2
+		if (g_NoiseBatchAVX2)
+		{
+			NoiseBatch2D<LanesAVX2>(settings, xs, ys, out, count);
+			return;
+		}
+#endif
+		NoiseBatch2D<LanesSSE2>(settings, xs, ys, out, count);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++)
+		out[i] = noise.GetNoise(xs[i], ys[i]);
+}
+
+void NoiseBatch::GetNoise(const FastNoiseLite& noise, const float* xs, const float* ys, const float* zs, float* out, size_t count)
+{
+#if NOISE_BATCH_SSE2
+	NoiseBatchSettings settings;
+	if (GetSettings(noise, settings))
+	{
+#if NOISE_BATCH_AVX2
+		if (g_NoiseBatchAVX2)
+		{
+			NoiseBatch3D<LanesAVX2>(settings, xs, ys, zs, out, count);
+			return;
+		}
+#endif
+		NoiseBatch3D<LanesSSE2>(settings, xs, ys, zs, out, count);
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++)
+		out[i] = noise.GetNoise(xs[i], ys[i], zs[i]);
+}
+
+// Grids are evaluated a row at a time, with the coordinates of each row written out first.
+static const u32 k_GridRowBlock = 256;
+
+void NoiseBatch::GenUniformGrid2D(const FastNoiseLite& noise, float* out, float x, float y, u32 sizeX, u32 sizeY, float step)
+{
+	float xs[k_GridRowBlock];
+	float ys[k_GridRowBlock];
+
+	for (u32 iy = 0; iy < sizeY; iy++)
+	{
+		for (u32 ix = 0; ix < sizeX; ix += k_GridRowBlock)
+		{
+			const u32 count = Min(sizeX - ix, k_GridRowBlock);
+			for (u32 i = 0; i < count; i++)
+			{
+				xs[i] = x + (float)(ix + i) * step;
+				ys[i] = y + (float)iy * step;
+			}
+
+			GetNoise(noise, xs, ys, out + (size_t)iy * sizeX + ix, count);
+		}
+	}
+}
+
+void NoiseBatch::GenUniformGrid3D(const FastNoiseLite& noise, float* out, float x, float y, float z, u32 sizeX, u32 sizeY, u32 sizeZ, float step)
+{
+	float xs[k_GridRowBlock];
+	float ys[k_GridRowBlock];
+	float zs[k_GridRowBlock];
+
+	for (u32 iz = 0; iz < sizeZ; iz++)
+	{
+		for (u32 iy = 0; iy < sizeY; iy++)
+		{
+			for (u32 ix = 0; ix < sizeX; ix += k_GridRowBlock)
+			{
+				const u32 count = Min(sizeX - ix, k_GridRowBlock);
+				for (u32 i = 0; i < count; i++)
+				{
+					xs[i] = x + (float)(ix + i) * step;
+					ys[i] = y + (float)iy * step;
+					zs[i] = z + (float)iz * step;
+				}
+
+				GetNoise(noise, xs, ys, zs, out + ((size_t)iz * sizeY + iy) * sizeX + ix, count);
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Surf/SurfMath.h"
+
+class FastNoiseLite;
+struct NoiseBatchSettings;
+
+// Evaluates FastNoiseLite for many positions in one call, matching GetNoise bit for bit. OpenSimplex2 noise, on its own
+// or as FBm or ridged fractal, runs 8 positions at a time with AVX2 where the CPU has it and 4 at a time with SSE2
+// otherwise. Any other settings fall back to calling GetNoise for each position.
+struct NoiseBatch
+{
+	// out[i] = noise.GetNoise(xs[i], ys[i]).
+	static void GetNoise(const FastNoiseLite& noise, const float* xs, const float* ys, float* out, size_t count);
+
+	// out[i] = noise.GetNoise(xs[i], ys[i], zs[i]).
+	static void GetNoise(const FastNoiseLite& noise, const float* xs, const float* ys, const float* zs, float* out, size_t count);
+
+	// Noise over the sizeX by sizeY grid of positions from x, y spaced step apart, written to out[iy * sizeX + ix].
+	static void GenUniformGrid2D(const FastNoiseLite& noise, float* out, float x, float y, u32 sizeX, u32 sizeY, float step = 1.0f);
+
+	// Noise over a 3D grid, written to out[(iz * sizeY + iy) * sizeX + ix].
+	static void GenUniformGrid3D(const FastNoiseLite& noise, float* out, float x, float y, float z, u32 sizeX, u32 sizeY, u32 sizeZ, float step = 1.0f);
+
+private:
+	// Copies out the settings the vectorised paths need, returning false if they don't cover them.
+	static bool GetSettings(const FastNoiseLite& noise, NoiseBatchSettings& settings);
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "Surf/SurfMath.h"
+
+#include <utility>
+#include <vector>
+
+// An open addressing hash table using Robin Hood linear probing. Keys and values are stored inline in the slots along
+// with each key's hash, so probing never has to recompute a hash or look anywhere else. Hasher returns the hash of a
+// key, whose low bits must be well distributed, and keys are compared with ==.
+template<typename Key, typename Value, typename Hasher>
+class RobinHoodMap
+{
+public:
+	Value* Find(const Key& key)
+	{
+		const u32 pos = FindSlot(key, HashOf(key));
+		return pos != EmptySlot ? &slots[pos].value : nullptr;
+	}
+
+	const Value* Find(const Key& key) const
+	{
+		const u32 pos = FindSlot(key, HashOf(key));
+		return pos != EmptySlot ? &slots[pos].value : nullptr;
+	}
+
+	// Adds key, which must not be in the table yet.
+	void Add(const Key& key, const Value& value)
+	{
+		// Keep the table at most three quarters full so probes stay short.
+		if ((count + 1) * 4 > (u32)slots.size() * 3)
+			Grow();
+
+		Slot slot;
+		slot.key = key;
+		slot.value = value;
+		slot.hash = HashOf(key);
+		Insert(slot);
+
+		count++;
+	}
+
+	// Removes key, returning false if it wasn't in the table. Its value is written to removed if given.
+	bool Remove(const Key& key, Value* removed = nullptr)
+	{
+		u32 pos = FindSlot(key, HashOf(key));
+		if (pos == EmptySlot)
+			return false;
+
+		if (removed)
+			*removed = slots[pos].value;
+
+		// Shift the entries after it back a slot until one is already home or the run ends, which keeps every probe
+		// sequence ordered without leaving tombstones.
+		for (u32 next = (pos + 1) & slotMask; slots[next].hash != 0 && next != HomeSlot(slots[next]); next = (next + 1) & slotMask)
+		{
+			slots[pos] = slots[next];
+			pos = next;
+		}
+
+		slots[pos] = Slot();
+		count--;
+
+		return true;
+	}
+
+	void Clear()
+	{
+		std::vector<Slot>().swap(slots);
+		slotMask = 0;
+		count = 0;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+private:
+	static constexpr u32 EmptySlot = ~0u;
+
+	// Hashes are stored with the top bit set, which the slot mask never reaches, so a zero hash marks an empty slot.
+	struct Slot
+	{
+		Key key{};
+		Value value{};
+		u32 hash = 0;
+	};
+
+	static u32 HashOf(const Key& key) { return (u32)Hasher()(key) | 0x80000000u; }
+
+	u32 HomeSlot(const Slot& slot) const { return slot.hash & slotMask; }
+
+	// The position in slots of key, or EmptySlot.
+	u32 FindSlot(const Key& key, u32 hash) const
+	{
+		if (count == 0)
+			return EmptySlot;
+
+		u32 pos = hash & slotMask;
+
+		// Robin Hood keeps every probe sequence ordered by distance from home, so a slot closer to its home than we
+		// are to ours means key is not in the table.
+		for (u32 distance = 0; ; distance++, pos = (pos + 1) & slotMask)
+		{
+			const Slot& slot = slots[pos];
+
+			if (slot.hash == 0 || ((pos - HomeSlot(slot)) & slotMask) < distance)
+				return EmptySlot;
+
+			if (slot.hash == hash && slot.key == key)
+				return pos;
+		}
+	}
+
+	void Insert(Slot slot)
+	{
+		u32 pos = HomeSlot(slot);
+
+		for (u32 distance = 0; ; distance++, pos = (pos + 1) & slotMask)
+		{
+			Slot& existing = slots[pos];
+
+			if (existing.hash == 0)
+			{
+				existing = slot;
+				return;
+			}
+
+			// Take the place of entries that are closer to home than we are and carry on inserting them instead.
+			const u32 existingDistance = (pos - HomeSlot(existing)) & slotMask;
+			if (existingDistance < distance)
+			{
+				std::swap(existing, slot);
+				distance = existingDistance;
+			}
+		}
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> oldSlots;
+		oldSlots.swap(slots);
+
+		slots.resize(oldSlots.empty() ? 64 : oldSlots.size() * 2);
+		slotMask = (u32)slots.size() - 1;
+
+		for (const Slot& slot : oldSlots)
+		{
+			if (slot.hash != 0)
+				Insert(slot);
+		}
+	}
+
+	std::vector<Slot> slots;
+	u32 slotMask = 0;
+	u32 count = 0;
+};
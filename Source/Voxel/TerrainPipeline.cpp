@@ -0,0 +1,442 @@
+#include "TerrainPipeline.h"
+
+#include "NoiseBatch.h"
+
+#include "Surf/HighResolutionClock.h"
+#include "ThirdParty/FastNoiseLite/FastNoistLite.h"
+
+#include <algorithm>
+
+// The column and chunk a thread is generating, plus its stage stats until they are added to the totals.
+struct TerrainScratch
+{
+	TerrainColumn column;
+	TerrainChunk chunk;
+	std::vector<TerrainStageStats> stats;
+	std::vector<ChunkVoxels::Row> carveRows;
+};
+
+static thread_local TerrainScratch g_TerrainScratch;
+
+bool TerrainChunk::Empty() const
+{
+	return std::all_of(materials.begin(), materials.end(), [](VoxelMaterial material) { return material == VoxelMaterial_Air; });
+}
+
+bool TerrainChunk::CopyTo(ChunkVoxels& voxels) const
+{
+	// All air or all buried, skip building rows.
+	const VoxelMaterial first = materials[0];
+	if (std::all_of(materials.begin(), materials.end(), [first](VoxelMaterial material) { return material == first; }))
+	{
+		voxels.Fill(first);
+		return first != VoxelMaterial_Air;
+	}
+
+	voxels.Fill(VoxelMaterial_Air);
+
+	for (u32 z = 0; z < dim; z++)
+	{
+		for (u32 y = 0; y < dim; y++)
+		{
+			ChunkVoxels::Row masks[VoxelMaterial_Count] = {};
+
+			const VoxelMaterial* row = &materials[Index(0, y, z)];
+			for (u32 x = 0; x < dim; x++)
+			{
+				assert(row[x] < VoxelMaterial_Count);
+				masks[row[x]] |= (ChunkVoxels::Row)((ChunkVoxels::Row)1 << x);
+			}
+
+			for (u32 material = VoxelMaterial_Air + 1; material < VoxelMaterial_Count; material++)
+				voxels.FillRow(y, z, masks[material], (VoxelMaterial)material);
+		}
+	}
+
+	return true;
+}
+
+void TerrainPipeline::AddStage(TerrainStage stage)
+{
+	assert(stage.generateChunk);
+
+	TerrainStageStats stats;
+	stats.name = stage.name;
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	lookAbove = Max(lookAbove, stage.lookAbove);
+	stages.push_back(std::move(stage));
+	totals.push_back(stats);
+}
+
+template<typename Fn>
+void TerrainPipeline::Run(u32 x, u32 z, u32 bottom, u32 top, Fn&& fn)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	TerrainScratch& scratch = g_TerrainScratch;
+	scratch.stats.assign(stages.size(), TerrainStageStats());
+
+	TerrainColumn& column = scratch.column;
+	column.x = x;
+	column.z = z;
+	column.top = 0;
+
+	HighResolutionClock clock;
+
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		if (stages[i].beginColumn)
+		{
+			clock.Reset();
+			stages[i].beginColumn(column);
+			clock.Tick();
+			scratch.stats[i].milliseconds += clock.GetDeltaMilliseconds();
+		}
+
+		scratch.stats[i].columns++;
+	}
+
+	TerrainChunk& chunk = scratch.chunk;
+	chunk.materials.resize((size_t)dim * dim * dim);
+	chunk.x = x;
+	chunk.z = z;
+
+	// Top down, so stages can carry what they have seen above into the chunks below.
+	u32 chunkCount = (column.top + dim - 1) / dim;
+	if (top < column.top)
+		chunkCount = (top + dim - 1) / dim;
+
+	for (u32 i = chunkCount; i-- > bottom / dim; )
+	{
+		chunk.y = i * dim;
+		std::fill(chunk.materials.begin(), chunk.materials.end(), VoxelMaterial_Air);
+
+		for (size_t s = 0; s < stages.size(); s++)
+		{
+			clock.Reset();
+			const u32 voxels = stages[s].generateChunk(column, chunk);
+			clock.Tick();
+
+			scratch.stats[s].milliseconds += clock.GetDeltaMilliseconds();
+			scratch.stats[s].chunks++;
+			scratch.stats[s].voxels += voxels;
+		}
+
+		fn(chunk);
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		totals[i].milliseconds += scratch.stats[i].milliseconds;
+		totals[i].columns += scratch.stats[i].columns;
+		totals[i].chunks += scratch.stats[i].chunks;
+		totals[i].voxels += scratch.stats[i].voxels;
+	}
+}
+
+void TerrainPipeline::GenerateColumn(VoxelColumn& column)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	column.chunks.clear();
+
+	u32 used = 0;
+	Run(column.x, column.z, 0, ~0u, [&](const TerrainChunk& chunk)
+	{
+		const u32 i = chunk.y / dim;
+		if (column.chunks.size() <= i)
+			column.chunks.resize(i + 1);
+
+		if (chunk.CopyTo(column.chunks[i]))
+			used = Max(used, i + 1);
+	});
+
+	// Nothing is kept above the highest solid voxel.
+	column.chunks.resize(used);
+}
+
+void TerrainPipeline::GenerateChunk(const ChunkCoord& cc, ChunkVoxels& voxels)
+{
+	// Above the top of the column the stages never reach the chunk.
+	voxels.Fill(VoxelMaterial_Air);
+
+	Run(cc.coord.x, cc.coord.z, cc.coord.y, cc.coord.y + (u32)Chunk::dim + lookAbove, [&](const TerrainChunk& chunk)
+	{
+		if (chunk.y == cc.coord.y)
+			chunk.CopyTo(voxels);
+	});
+}
+
+void TerrainPipeline::GetStats(std::vector<TerrainStageStats>& stats) const
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats = totals;
+}
+
+void TerrainPipeline::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	for (TerrainStageStats& stats : totals)
+	{
+		const char* name = stats.name;
+		stats = TerrainStageStats();
+		stats.name = name;
+	}
+}
+
+TerrainStage MakeHeightmapStage(const FastNoiseLite& noise, float base, float amplitude, VoxelMaterial material)
+{
+	TerrainStage stage;
+	stage.name = "Heightmap";
+
+	stage.beginColumn = [noise, base, amplitude](TerrainColumn& column)
+	{
+		constexpr u32 dim = (u32)Chunk::dim;
+
+		float values[dim * dim];
+		NoiseBatch::GenUniformGrid2D(noise, values, (float)column.x, (float)column.z, dim, dim);
+
+		for (u32 i = 0; i < dim * dim; i++)
+		{
+			const float n = (values[i] + 1.0f) * 0.5f;
+			column.heights[i] = (u32)Max(n * amplitude + base, 0.0f);
+			column.top = Max(column.top, column.heights[i]);
+		}
+	};
+
+	stage.generateChunk = [material](TerrainColumn& column, TerrainChunk& chunk)
+	{
+		constexpr u32 dim = (u32)Chunk::dim;
+
+		u32 written = 0;
+		for (u32 z = 0; z < dim; z++)
+		{
+			for (u32 x = 0; x < dim; x++)
+			{
+				const u32 height = column.heights[z * dim + x];
+				if (height <= chunk.y)
+					continue;
+
+				const u32 end = Min(height - chunk.y, dim);
+				for (u32 y = 0; y < end; y++)
+					chunk.materials[TerrainChunk::Index(x, y, z)] = material;
+
+				written += end;
+			}
+		}
+
+		return written;
+	};
+
+	return stage;
+}
+
+TerrainStage MakeCarveStage(const VoxelDensity& density)
+{
+	TerrainStage stage;
+	stage.name = "Carve";
+
+	stage.generateChunk = [density](TerrainColumn&, TerrainChunk& chunk)
+	{
+		constexpr u32 dim = (u32)Chunk::dim;
+
+		// Nothing to carve out of the air above the ground, and no noise to sample for it.
+		if (chunk.Empty())
+			return 0u;
+
+		std::vector<ChunkVoxels::Row>& rows = g_TerrainScratch.carveRows;
+		rows.resize((size_t)dim * dim);
+
+		const DensityCoverage coverage = density.SampleRows(chunk.x, chunk.y, chunk.z, rows.data());
+		if (coverage == DensityCoverage::Empty)
+			return 0u;
+
+		u32 carved = 0;
+		for (u32 z = 0; z < dim; z++)
+		{
+			for (u32 y = 0; y < dim; y++)
+			{
+				u64 mask = coverage == DensityCoverage::Full ? (u64)ChunkVoxels::FullRow : (u64)rows[(size_t)z * dim + y];
+				VoxelMaterial* row = &chunk.materials[TerrainChunk::Index(0, y, z)];
+
+				for (; mask; mask &= mask - 1)
+				{
+					VoxelMaterial& material = row[CountTrailingZeros64(mask)];
+					if (material != VoxelMaterial_Air)
+					{
+						material = VoxelMaterial_Air;
+						carved++;
+					}
+				}
+			}
+		}
+
+		return carved;
+	};
+
+	return stage;
+}
+
+TerrainStage MakeSurfaceStage(const VoxelLayer* layers, u32 layerCount)
+{
+	assert(layerCount > 0);
+
+	// The material at each depth down through the bands, below them every voxel is the last layer.
+	std::vector<VoxelMaterial> bands;
+	for (u32 i = 0; i + 1 < layerCount; i++)
+		bands.insert(bands.end(), layers[i].thickness, layers[i].material);
+
+	const VoxelMaterial below = layers[layerCount - 1].material;
+
+	TerrainStage stage;
+	stage.name = "Surface";
+
+	// Depths stop counting at the bottom of the bands, so starting that far above a chunk colours it the same as
+	// starting at the top of the column.
+	stage.lookAbove = (u32)bands.size();
+
+	stage.beginColumn = [](TerrainColumn& column)
+	{
+		std::fill(std::begin(column.surfaceDepths), std::end(column.surfaceDepths), 0u);
+	};
+
+	stage.generateChunk = [bands, below](TerrainColumn& column, TerrainChunk& chunk)
+	{
+		constexpr u32 dim = (u32)Chunk::dim;
+		const u32 bandDepth = (u32)bands.size();
+
+		u32 written = 0;
+		for (u32 z = 0; z < dim; z++)
+		{
+			for (u32 x = 0; x < dim; x++)
+			{
+				u32& depth = column.surfaceDepths[z * dim + x];
+
+				for (u32 y = dim; y-- > 0; )
+				{
+					VoxelMaterial& material = chunk.materials[TerrainChunk::Index(x, y, z)];
+					if (material == VoxelMaterial_Air)
+					{
+						depth = 0;
+						continue;
+					}
+
+					const VoxelMaterial surface = depth < bandDepth ? bands[depth] : below;
+					if (material != surface)
+					{
+						material = surface;
+						written++;
+					}
+
+					depth = Min(depth + 1, bandDepth);
+				}
+			}
+		}
+
+		return written;
+	};
+
+	return stage;
+}
+
+struct Boulder
+{
+	u32 x;
+	u32 y;
+	u32 z;
+	u32 radius;
+};
+
+static u32 HashColumn(u32 x, u32 z, u32 attempt, u32 seed)
+{
+	u32 h = seed ^ (x * 0x27d4eb2du) ^ (z * 0x165667b1u) ^ (attempt * 0x9e3779b9u);
+	h ^= h >> 15;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+// Where the column's boulder for attempt sits, if it has one. Relative to the column's corner.
+static bool PlaceBoulder(const TerrainColumn& column, u32 seed, u32 attempt, float chance, u32 maxRadius, Boulder& boulder)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	const u32 roll = HashColumn(column.x, column.z, attempt, seed);
+	if ((float)(roll & 0xffff) >= chance * 65536.0f)
+		return false;
+
+	const u32 place = HashColumn(column.x, column.z, attempt, seed + 1);
+
+	boulder.radius = 1 + (roll >> 16) % maxRadius;
+
+	const u32 span = dim - 2 * boulder.radius;
+	boulder.x = boulder.radius + (place & 0xffff) % span;
+	boulder.z = boulder.radius + (place >> 16) % span;
+	boulder.y = column.heights[boulder.z * dim + boulder.x];
+
+	return true;
+}
+
+TerrainStage MakeBoulderStage(u32 seed, u32 attempts, float chance, u32 maxRadius, VoxelMaterial material)
+{
+	assert(maxRadius > 0 && maxRadius < Chunk::dim / 2);
+
+	TerrainStage stage;
+	stage.name = "Boulders";
+
+	stage.beginColumn = [seed, attempts, chance, maxRadius](TerrainColumn& column)
+	{
+		Boulder boulder;
+		for (u32 i = 0; i < attempts; i++)
+		{
+			if (PlaceBoulder(column, seed, i, chance, maxRadius, boulder))
+				column.top = Max(column.top, boulder.y + boulder.radius + 1);
+		}
+	};
+
+	stage.generateChunk = [seed, attempts, chance, maxRadius, material](TerrainColumn& column, TerrainChunk& chunk)
+	{
+		constexpr i32 dim = (i32)Chunk::dim;
+
+		u32 written = 0;
+
+		Boulder boulder;
+		for (u32 i = 0; i < attempts; i++)
+		{
+			if (!PlaceBoulder(column, seed, i, chance, maxRadius, boulder))
+				continue;
+
+			const i32 r = (i32)boulder.radius;
+			const i32 centreY = (i32)boulder.y - (i32)chunk.y;
+			if (centreY + r < 0 || centreY - r >= dim)
+				continue;
+
+			for (i32 dz = -r; dz <= r; dz++)
+			{
+				for (i32 dy = Max(-r, -centreY); dy <= r && centreY + dy < dim; dy++)
+				{
+					for (i32 dx = -r; dx <= r; dx++)
+					{
+						if (dx * dx + dy * dy + dz * dz > r * r + r)
+							continue;
+
+						VoxelMaterial& voxel = chunk.materials[TerrainChunk::Index(boulder.x + dx, centreY + dy, boulder.z + dz)];
+						if (voxel == VoxelMaterial_Air)
+						{
+							voxel = material;
+							written++;
+						}
+					}
+				}
+			}
+		}
+
+		return written;
+	};
+
+	return stage;
+}
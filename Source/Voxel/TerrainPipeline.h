@@ -0,0 +1,133 @@
+#pragma once
+
+#include "VoxelDensity.h"
+#include "VoxelWorld.h"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class FastNoiseLite;
+
+// One band of the surface, listed from the top down. The last layer fills the rest of the column.
+struct VoxelLayer
+{
+	u32 thickness;
+	VoxelMaterial material;
+};
+
+// The column a pipeline is generating, shared by its stages while they work down it.
+struct TerrainColumn
+{
+	static const size_t dim = ChunkVoxels::dim;
+
+	// The voxel coordinate of the column's corner.
+	u32 x = 0;
+	u32 z = 0;
+
+	// Chunks are generated below top, rounded up to whole chunks. Each stage raises it as far as it may write.
+	u32 top = 0;
+
+	// Written by the heightmap stage, heights[z * dim + x].
+	u32 heights[dim * dim];
+
+	// Solid voxels above each x, z since the last air, carried down from chunk to chunk by the surface stage.
+	u32 surfaceDepths[dim * dim];
+};
+
+// A chunk-sized buffer the stages write to, one material per voxel.
+struct TerrainChunk
+{
+	static const size_t dim = ChunkVoxels::dim;
+
+	// The voxel coordinate of the chunk's corner.
+	u32 x = 0;
+	u32 y = 0;
+	u32 z = 0;
+
+	// Laid out at Index(x, y, z), so the voxels of a row along x are next to each other.
+	std::vector<VoxelMaterial> materials;
+
+	static size_t Index(u32 x, u32 y, u32 z) { return ((size_t)z * dim + y) * dim + x; }
+
+	bool Empty() const;
+
+	// Overwrites voxels with the buffer, returning false if it was all air.
+	bool CopyTo(ChunkVoxels& voxels) const;
+};
+
+// One step of generation. Stages run in the order they were added, for each column and then for each of its chunks
+// from the top down, and are called from any thread at once.
+struct TerrainStage
+{
+	const char* name = "";
+
+	// Called once per column before any of its chunks. Optional.
+	std::function<void(TerrainColumn& column)> beginColumn;
+
+	// Called for each chunk of the column, returning how many voxels it wrote.
+	std::function<u32(TerrainColumn& column, TerrainChunk& chunk)> generateChunk;
+
+	// How far above a chunk the stage has to have worked down the column to get the chunk right, for stages that
+	// carry state down it.
+	u32 lookAbove = 0;
+};
+
+struct TerrainStageStats
+{
+	const char* name = "";
+	double milliseconds = 0.0;	// Summed over every thread.
+	u64 columns = 0;
+	u64 chunks = 0;
+	u64 voxels = 0;				// Written by the stage.
+};
+
+// Generates terrain a column at a time through an ordered list of stages, timing and counting each one.
+struct TerrainPipeline
+{
+	TerrainPipeline() = default;
+	TerrainPipeline(const TerrainPipeline&) = delete;
+	TerrainPipeline& operator=(const TerrainPipeline&) = delete;
+
+	// Stages can't be added once generation has started.
+	void AddStage(TerrainStage stage);
+
+	// Fills column.chunks for the column at column.x, column.z, up to the highest solid voxel. Thread safe.
+	void GenerateColumn(VoxelColumn& column);
+
+	// Fills voxels with the one chunk at cc. Stages carry state down the column, so it starts as far above cc as the
+	// stages look and throws away the chunks generated on the way down. Thread safe.
+	void GenerateChunk(const ChunkCoord& cc, ChunkVoxels& voxels);
+
+	// The totals for each stage since the last reset, in stage order.
+	void GetStats(std::vector<TerrainStageStats>& stats) const;
+	void ResetStats();
+
+private:
+	// Runs the stages down the column from below height top to its chunk at height bottom, calling fn(chunk) for each.
+	template<typename Fn>
+	void Run(u32 x, u32 z, u32 bottom, u32 top, Fn&& fn);
+
+	std::vector<TerrainStage> stages;
+
+	// The furthest any stage looks above a chunk.
+	u32 lookAbove = 0;
+
+	mutable std::mutex statsMutex;
+	std::vector<TerrainStageStats> totals;
+};
+
+// Fills every voxel below the height of the noise at each x, z with material. Heights run from base up to base +
+// amplitude.
+TerrainStage MakeHeightmapStage(const FastNoiseLite& noise, float base, float amplitude, VoxelMaterial material = VoxelMaterial_Stone);
+
+// Carves out the voxels where the density is solid.
+TerrainStage MakeCarveStage(const VoxelDensity& density);
+
+// Recolours solid voxels by how far below air they are, through the layers from the top down.
+TerrainStage MakeSurfaceStage(const VoxelLayer* layers, u32 layerCount);
+
+// Scatters boulders of material half buried in the heightmap, so it has to come after the heightmap stage. They are
+// placed from the seed and the column so they come out the same every time, each column tries attempts times and
+// keeps each with chance. Boulders stay inside their column, maxRadius can be at most dim / 2 - 1.
+TerrainStage MakeBoulderStage(u32 seed, u32 attempts, float chance, u32 maxRadius, VoxelMaterial material = VoxelMaterial_Stone);
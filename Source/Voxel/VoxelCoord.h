@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Chunk.h"
+
+#define VOXEL_MASK ((1u << (VOXELS_PER_CHUNK)) - 1u)
+#define CHUNK_MASK (~VOXEL_MASK)
+
+struct VoxelCoord
+{
+	union
+	{
+		struct
+		{
+			u32 blockX : VOXELS_PER_CHUNK;
+			u32 chunkX : 32 - VOXELS_PER_CHUNK;
+		};
+		u32 x;
+	};
+
+	union
+	{
+		struct
+		{
+			u32 blockY : VOXELS_PER_CHUNK;
+			u32 chunkY : 32 - VOXELS_PER_CHUNK;
+		};
+		u32 y;
+	};
+
+	union
+	{
+		struct
+		{
+			u32 blockZ : VOXELS_PER_CHUNK;
+			u32 chunkZ : 32 - VOXELS_PER_CHUNK;
+		};
+		u32 z;
+	};
+
+	VoxelCoord(u32 _x, u32 _y, u32 _z) : x(_x), y(_y), z(_z) {}
+};
+
+// Mixes three coordinates into a hash whose low bits are well distributed.
+inline u64 HashCoord(u32 x, u32 y, u32 z)
+{
+	const u64 h = (u64)x * 0x9E3779B97F4A7C15ull ^ (u64)y * 0xC2B2AE3D27D4EB4Full ^ (u64)z * 0x165667B19E3779F9ull;
+	return h ^ (h >> 29);
+}
+
+struct ChunkCoord
+{
+	VoxelCoord coord;
+	ChunkCoord() : coord(0u, 0u, 0u) {}
+	ChunkCoord(const VoxelCoord& _coord) : coord(_coord.x & CHUNK_MASK, _coord.y & CHUNK_MASK, _coord.z & CHUNK_MASK) {}
+	ChunkCoord(u32 _x, u32 _y, u32 _z) : coord(_x & CHUNK_MASK, _y & CHUNK_MASK, _z & CHUNK_MASK) {}
+
+	bool operator==(const ChunkCoord& other) const { return coord.chunkX == other.coord.chunkX && coord.chunkY == other.coord.chunkY && coord.chunkZ == other.coord.chunkZ; }
+
+	// Mixes all the chunk bits of the coordinate, the low bits are well distributed.
+	u64 Hash() const { return HashCoord(coord.chunkX, coord.chunkY, coord.chunkZ); }
+
+	ChunkCoord Neighbour(FaceDir dir) const
+	{
+		const u32 step = (dir & 1u) ? (u32)Chunk::dim : (u32)-(i32)Chunk::dim;
+		switch (dir)
+		{
+		case FaceDir_NegX:
+		case FaceDir_PosX:
+			return ChunkCoord(coord.x + step, coord.y, coord.z);
+		case FaceDir_NegY:
+		case FaceDir_PosY:
+			return ChunkCoord(coord.x, coord.y + step, coord.z);
+		default:
+			return ChunkCoord(coord.x, coord.y, coord.z + step);
+		}
+	}
+};
+
+struct ChunkCoordHash
+{
+	u64 operator()(const ChunkCoord& cc) const { return cc.Hash(); }
+};
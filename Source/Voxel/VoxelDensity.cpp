@@ -0,0 +1,104 @@
+#include "VoxelDensity.h"
+
+#include "NoiseBatch.h"
+
+#include <algorithm>
+
+// The lattice and its positions and the planes and lines interpolated from it, reused between chunks.
+struct DensityScratch
+{
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> zs;
+	std::vector<float> lattice;
+	std::vector<float> plane;
+	std::vector<float> line;
+};
+
+static thread_local DensityScratch g_DensityScratch;
+
+DensityCoverage VoxelDensity::SampleRows(u32 x, u32 y, u32 z, ChunkVoxels::Row* rows) const
+{
+	constexpr u32 dim = (u32)ChunkVoxels::dim;
+
+	assert(noise);
+	assert(cellSize > 0 && cellSize <= dim && (cellSize & (cellSize - 1)) == 0);
+
+	const u32 cellShift = CountTrailingZeros64(cellSize);
+	const u32 cellMask = cellSize - 1;
+	const float invCellSize = 1.0f / (float)cellSize;
+
+	// Lattice points per side, including the ones on the far faces shared with the next chunk.
+	const u32 n = dim / cellSize + 1;
+
+	DensityScratch& scratch = g_DensityScratch;
+	scratch.xs.resize((size_t)n * n * n);
+	scratch.ys.resize((size_t)n * n * n);
+	scratch.zs.resize((size_t)n * n * n);
+	scratch.lattice.resize((size_t)n * n * n);
+	scratch.plane.resize((size_t)n * n);
+	scratch.line.resize(n);
+
+	const float* lattice = scratch.lattice.data();
+	float* plane = scratch.plane.data();
+	float* line = scratch.line.data();
+
+	// Each lattice point is scaled from its own voxel coordinate rather than stepped from the chunk corner, so the
+	// points on a face shared with the next chunk come out at exactly the same positions and no seam opens up.
+	size_t point = 0;
+	for (u32 lz = 0; lz < n; lz++)
+	{
+		for (u32 ly = 0; ly < n; ly++)
+		{
+			for (u32 lx = 0; lx < n; lx++, point++)
+			{
+				scratch.xs[point] = (float)(x + lx * cellSize) * scale;
+				scratch.ys[point] = (float)(y + ly * cellSize) * scale;
+				scratch.zs[point] = (float)(z + lz * cellSize) * scale;
+			}
+		}
+	}
+
+	NoiseBatch::GetNoise(*noise, scratch.xs.data(), scratch.ys.data(), scratch.zs.data(), scratch.lattice.data(), point);
+
+	// Interpolating never leaves the range of the corners, so a lattice entirely on one side of the threshold decides
+	// the whole chunk.
+	const auto range = std::minmax_element(scratch.lattice.begin(), scratch.lattice.end());
+	if (*range.first > threshold)
+		return DensityCoverage::Full;
+	if (*range.second <= threshold)
+		return DensityCoverage::Empty;
+
+	// Interpolate along z to a plane of samples for each slice, then along y to a line for each row, leaving one lerp
+	// along x per voxel.
+	for (u32 vz = 0; vz < dim; vz++)
+	{
+		const float tz = (float)(vz & cellMask) * invCellSize;
+		const float* z0 = lattice + (size_t)(vz >> cellShift) * n * n;
+		const float* z1 = z0 + (size_t)n * n;
+		for (u32 i = 0; i < n * n; i++)
+			plane[i] = z0[i] + (z1[i] - z0[i]) * tz;
+
+		for (u32 vy = 0; vy < dim; vy++)
+		{
+			const float ty = (float)(vy & cellMask) * invCellSize;
+			const float* y0 = plane + (size_t)(vy >> cellShift) * n;
+			const float* y1 = y0 + n;
+			for (u32 i = 0; i < n; i++)
+				line[i] = y0[i] + (y1[i] - y0[i]) * ty;
+
+			ChunkVoxels::Row row = 0;
+			for (u32 vx = 0; vx < dim; vx++)
+			{
+				const float tx = (float)(vx & cellMask) * invCellSize;
+				const float* x0 = line + (vx >> cellShift);
+				if (x0[0] + (x0[1] - x0[0]) * tx > threshold)
+					row |= (ChunkVoxels::Row)((ChunkVoxels::Row)1 << vx);
+			}
+
+			rows[(size_t)vz * dim + vy] = row;
+		}
+	}
+
+	return DensityCoverage::Partial;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Chunk.h"
+
+class FastNoiseLite;
+
+// How much of a chunk is solid.
+enum class DensityCoverage : u8
+{
+	Empty,
+	Partial,
+	Full,
+};
+
+// A 3D noise density, solid wherever it is above the threshold. Noise is only sampled on a lattice every cellSize
+// voxels and trilinearly interpolated in between, so a chunk costs (dim / cellSize + 1)^3 noise calls rather than
+// dim^3. The lattice is anchored to world coordinates, so neighbouring chunks agree along their shared faces.
+struct VoxelDensity
+{
+	const FastNoiseLite* noise = nullptr;
+
+	// Noise units per voxel.
+	float scale = 1.0f;
+
+	float threshold = 0.0f;
+
+	// Voxels between lattice samples, a power of two no larger than the chunk dimension.
+	u32 cellSize = 4;
+
+	// Writes the solid voxels of the chunk whose corner is at voxel x, y, z to rows[z * dim + y], one bit per voxel
+	// along x. The rows are only written when the chunk is partially solid.
+	DensityCoverage SampleRows(u32 x, u32 y, u32 z, ChunkVoxels::Row* rows) const;
+};
@@ -0,0 +1,166 @@
+#include "VoxelEditBatch.h"
+
+#include <algorithm>
+
+u32 VoxelEditBatch::ChunkIndex(const ChunkCoord& cc)
+{
+	if (chunks.size() * 2 >= chunkTable.size())
+	{
+		chunkTable.assign(Max<size_t>(chunkTable.size() * 2, 64), ~0u);
+		for (u32 i = 0; i < (u32)chunks.size(); i++)
+		{
+			u32 pos = (u32)chunks[i].Hash() & (u32)(chunkTable.size() - 1);
+			while (chunkTable[pos] != ~0u)
+				pos = (pos + 1) & (u32)(chunkTable.size() - 1);
+			chunkTable[pos] = i;
+		}
+	}
+
+	const u32 slotMask = (u32)chunkTable.size() - 1;
+	for (u32 pos = (u32)cc.Hash() & slotMask; ; pos = (pos + 1) & slotMask)
+	{
+		if (chunkTable[pos] == ~0u)
+		{
+			chunkTable[pos] = (u32)chunks.size();
+			chunks.push_back(cc);
+			return chunkTable[pos];
+		}
+
+		if (chunks[chunkTable[pos]] == cc)
+			return chunkTable[pos];
+	}
+}
+
+void VoxelEditBatch::Commit(VoxelWorld& world)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+	constexpr u32 last = dim - 1;
+
+	if (edits.empty())
+		return;
+
+	assert(edits.size() <= ~0u);
+
+	// Each edit's chunk index and row packed together, chunk in the top half.
+	keys.resize(edits.size());
+
+	u32 lastChunk[3] = { edits[0].x & CHUNK_MASK, edits[0].y & CHUNK_MASK, edits[0].z & CHUNK_MASK };
+	u32 lastChunkIndex = ChunkIndex(ChunkCoord(lastChunk[0], lastChunk[1], lastChunk[2]));
+
+	for (u32 i = 0; i < (u32)edits.size(); i++)
+	{
+		const Edit& edit = edits[i];
+
+		// Brushes tend to make runs of edits in the same chunk.
+		if ((edit.x & CHUNK_MASK) != lastChunk[0] || (edit.y & CHUNK_MASK) != lastChunk[1] || (edit.z & CHUNK_MASK) != lastChunk[2])
+		{
+			lastChunk[0] = edit.x & CHUNK_MASK;
+			lastChunk[1] = edit.y & CHUNK_MASK;
+			lastChunk[2] = edit.z & CHUNK_MASK;
+			lastChunkIndex = ChunkIndex(ChunkCoord(edit.x, edit.y, edit.z));
+		}
+
+		keys[i] = (lastChunkIndex << 16) | (u32)ChunkVoxels::RowIndex(edit.y & VOXEL_MASK, edit.z & VOXEL_MASK);
+	}
+
+	assert(chunks.size() <= 0xFFFFu);
+	static_assert(Chunk::dim * Chunk::dim <= 0x10000u, "Chunk row indices must fit in the low half of the sort keys");
+
+	// Group by chunk then by row with two stable counting sorts, rows first, so edits to a voxel keep their order.
+	order.resize(edits.size());
+	sortScratch.resize(edits.size());
+
+	auto CountingSort = [this](const u32* in, u32* out, u32 bucketCount, u32 shift)
+	{
+		bucketStarts.assign(bucketCount + 1, 0u);
+		for (size_t i = 0; i < edits.size(); i++)
+			bucketStarts[((keys[in[i]] >> shift) & 0xFFFFu) + 1]++;
+
+		for (u32 bucket = 0; bucket < bucketCount; bucket++)
+			bucketStarts[bucket + 1] += bucketStarts[bucket];
+
+		for (size_t i = 0; i < edits.size(); i++)
+			out[bucketStarts[(keys[in[i]] >> shift) & 0xFFFFu]++] = in[i];
+	};
+
+	for (u32 i = 0; i < (u32)edits.size(); i++)
+		order[i] = i;
+
+	CountingSort(order.data(), sortScratch.data(), (u32)(Chunk::dim * Chunk::dim), 0);
+	CountingSort(sortScratch.data(), order.data(), (u32)chunks.size(), 16);
+
+	auto EditAt = [&](size_t i) -> const Edit& { return edits[order[i]]; };
+	auto ChunkOf = [&](size_t i) { return keys[order[i]] >> 16; };
+	auto RowOf = [&](size_t i) { return keys[order[i]] & 0xFFFFu; };
+
+	size_t chunkBegin = 0;
+	while (chunkBegin < order.size())
+	{
+		const u32 chunkIndex = ChunkOf(chunkBegin);
+		const ChunkCoord& cc = chunks[chunkIndex];
+
+		size_t chunkEnd = chunkBegin;
+		bool onlyRemoves = true;
+		for (; chunkEnd < order.size() && ChunkOf(chunkEnd) == chunkIndex; chunkEnd++)
+			onlyRemoves &= EditAt(chunkEnd).material == VoxelMaterial_Air;
+
+		// Removing voxels never needs to create a chunk.
+		Chunk* chunk = onlyRemoves ? world.FindChunk(cc) : &world.chunks.FindOrAdd(cc);
+		if (!chunk)
+		{
+			chunkBegin = chunkEnd;
+			continue;
+		}
+
+		u32 dirtySections = 0;
+		u32 neighbourSections[FaceDir_Count] = {};
+
+		// Consecutive edits to a row with the same material are merged into one masked write, and the sections they
+		// dirty worked out once per write.
+		ChunkVoxels::Row mask = 0;
+		for (size_t i = chunkBegin; i < chunkEnd; i++)
+		{
+			const Edit& edit = EditAt(i);
+			const u32 x = edit.x & VOXEL_MASK;
+			const u32 y = edit.y & VOXEL_MASK;
+			const u32 z = edit.z & VOXEL_MASK;
+
+			mask |= (ChunkVoxels::Row)((ChunkVoxels::Row)1 << x);
+
+			if (i + 1 < chunkEnd && RowOf(i + 1) == RowOf(i) && EditAt(i + 1).material == edit.material)
+				continue;
+
+			chunk->voxels.FillRow(y, z, mask, edit.material);
+
+			dirtySections |= ChunkSectionMask(z > 0 ? z - 1 : 0, z < last ? z + 2 : dim);
+
+			// Across an x or y border the neighbour's faces are in the same z slice, across a z border they are in
+			// its first or last slice.
+			const u32 section = 1u << ChunkSectionOf(z);
+			neighbourSections[FaceDir_NegX] |= (mask & 1u) ? section : 0u;
+			neighbourSections[FaceDir_PosX] |= (mask >> last) ? section : 0u;
+			neighbourSections[FaceDir_NegY] |= y == 0 ? section : 0u;
+			neighbourSections[FaceDir_PosY] |= y == last ? section : 0u;
+			neighbourSections[FaceDir_NegZ] |= z == 0 ? 1u << ChunkSectionOf(last) : 0u;
+			neighbourSections[FaceDir_PosZ] |= z == last ? 1u << ChunkSectionOf(0) : 0u;
+
+			mask = 0;
+		}
+
+		chunk->dirtySections |= dirtySections;
+		world.MarkOccupancyStale(cc, *chunk);
+
+		for (u32 dir = 0; dir < FaceDir_Count; dir++)
+		{
+			if (neighbourSections[dir] == 0)
+				continue;
+
+			if (Chunk* neighbour = chunk->neighbours[dir])
+				neighbour->dirtySections |= neighbourSections[dir];
+		}
+
+		chunkBegin = chunkEnd;
+	}
+
+	Clear();
+}
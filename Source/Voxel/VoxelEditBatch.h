@@ -0,0 +1,52 @@
+#pragma once
+
+#include "VoxelWorld.h"
+
+#include <algorithm>
+#include <vector>
+
+// Collects voxel edits so a brush touching many voxels pays for each chunk once rather than for every voxel. Commit
+// sorts the edits by chunk and row, writes each row a word at a time and dirties every affected chunk and neighbour
+// section once. Reusing a batch avoids any allocation once it has grown to the largest edit.
+struct VoxelEditBatch
+{
+	// Setting air removes the voxel.
+	void Set(u32 x, u32 y, u32 z, VoxelMaterial material = VoxelMaterial_Stone) { edits.push_back({ x, y, z, material }); }
+	void Remove(u32 x, u32 y, u32 z) { Set(x, y, z, VoxelMaterial_Air); }
+
+	size_t Size() const { return edits.size(); }
+	bool Empty() const { return edits.empty(); }
+	void Clear()
+	{
+		edits.clear();
+		chunks.clear();
+		std::fill(chunkTable.begin(), chunkTable.end(), ~0u);
+	}
+
+	// Applies the edits to world then clears the batch. Edits to the same voxel apply in the order they were made.
+	void Commit(VoxelWorld& world);
+
+private:
+	struct Edit
+	{
+		u32 x;
+		u32 y;
+		u32 z;
+		VoxelMaterial material;
+	};
+
+	// Index of cc in chunks, adding it if this is the first edit to it.
+	u32 ChunkIndex(const ChunkCoord& cc);
+
+	std::vector<Edit> edits;
+
+	// The chunks the edits touch, with a small open addressing table to find them.
+	std::vector<ChunkCoord> chunks;
+	std::vector<u32> chunkTable;
+
+	// Commit scratch, kept to avoid allocating. Edit indices sorted by chunk, row then the order they were made.
+	std::vector<u32> keys;
+	std::vector<u32> order;
+	std::vector<u32> sortScratch;
+	std::vector<u32> bucketStarts;
+};
@@ -0,0 +1,64 @@
+#include "VoxelOccupancy.h"
+
+void VoxelOccupancy::SetChunkOccupied(u32 cx, u32 cy, u32 cz, bool occupied)
+{
+	for (u32 level = 1; level <= LevelCount; level++)
+	{
+		NodeTable& nodes = levels[level - 1];
+		const NodeKey key = KeyAt(level, cx, cy, cz);
+		const u64 bit = ChildBit(level, cx, cy, cz);
+
+		u64* mask = nodes.Find(key);
+
+		if (occupied)
+		{
+			if (!mask)
+			{
+				nodes.Add(key, bit);
+				continue;
+			}
+
+			// The levels above already know about a node that was occupied.
+			*mask |= bit;
+			return;
+		}
+		else
+		{
+			if (!mask)
+				return;
+
+			*mask &= ~bit;
+			if (*mask != 0)
+				return;
+
+			// The node has emptied, so clear its own bit in the level above.
+			nodes.Remove(key);
+		}
+	}
+}
+
+u32 VoxelOccupancy::EmptyLevel(u32 cx, u32 cy, u32 cz) const
+{
+	const u64* top = levels[LevelCount - 1].Find(KeyAt(LevelCount, cx, cy, cz));
+	if (!top)
+		return LevelCount + 1;
+
+	u64 mask = *top;
+	for (u32 level = LevelCount; ; level--)
+	{
+		if ((mask & ChildBit(level, cx, cy, cz)) == 0)
+			return level;
+
+		if (level == 1)
+			return 0;
+
+		// An occupied cell always has its node in the level below.
+		mask = *levels[level - 2].Find(KeyAt(level - 1, cx, cy, cz));
+	}
+}
+
+void VoxelOccupancy::Clear()
+{
+	for (NodeTable& nodes : levels)
+		nodes.Clear();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "RobinHoodMap.h"
+#include "VoxelCoord.h"
+
+// Coarse occupancy of the world above the chunks, for skipping empty space. Each level is a sparse set of nodes
+// holding one bit per occupied cell of the 4x4x4 block of cells below it, chunks at the bottom. Only nodes with a bit
+// set are kept, so a missing node is an empty region and a query can step over it in one go.
+struct VoxelOccupancy
+{
+	// The top level cells are 4^LevelCount chunks across.
+	static constexpr u32 LevelCount = 4;
+
+	// Records whether the chunk at chunk index cx, cy, cz holds any solid voxels, updating the levels above it.
+	void SetChunkOccupied(u32 cx, u32 cy, u32 cz, bool occupied);
+
+	// The level of the largest empty cell containing the chunk at chunk index cx, cy, cz. Zero when the chunk itself
+	// is occupied, otherwise the empty cell is 4^(level - 1) chunks across.
+	u32 EmptyLevel(u32 cx, u32 cy, u32 cz) const;
+
+	void Clear();
+
+private:
+	struct NodeKey
+	{
+		u32 x = 0;
+		u32 y = 0;
+		u32 z = 0;
+
+		bool operator==(const NodeKey& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct NodeKeyHash
+	{
+		u64 operator()(const NodeKey& key) const { return HashCoord(key.x, key.y, key.z); }
+	};
+
+	// Each node's mask of occupied cells, never zero.
+	typedef RobinHoodMap<NodeKey, u64, NodeKeyHash> NodeTable;
+
+	static NodeKey KeyAt(u32 level, u32 cx, u32 cy, u32 cz) { return { cx >> (2 * level), cy >> (2 * level), cz >> (2 * level) }; }
+
+	// Bit of the cell containing chunk cx, cy, cz within its node at level.
+	static u64 ChildBit(u32 level, u32 cx, u32 cy, u32 cz)
+	{
+		const u32 shift = 2 * (level - 1);
+		return 1ull << (((cx >> shift) & 3u) | (((cy >> shift) & 3u) << 2) | (((cz >> shift) & 3u) << 4));
+	}
+
+	// levels[i] holds the nodes of level i + 1.
+	NodeTable levels[LevelCount];
+};
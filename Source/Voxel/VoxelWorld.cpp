@@ -0,0 +1,237 @@
+#include "VoxelWorld.h"
+
+#include <algorithm>
+#include <cmath>
+
+void VoxelWorld::MarkAllDirty()
+{
+	for (ChunkMap::Entry& entry : chunks)
+		entry.chunk.MarkDirty();
+}
+
+void VoxelWorld::FillBox(u32 minX, u32 minY, u32 minZ, u32 maxX, u32 maxY, u32 maxZ, VoxelMaterial material)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	for (u32 cz = minZ & CHUNK_MASK; cz < maxZ; cz += dim)
+	{
+		for (u32 cy = minY & CHUNK_MASK; cy < maxY; cy += dim)
+		{
+			for (u32 cx = minX & CHUNK_MASK; cx < maxX; cx += dim)
+			{
+				const ChunkCoord cc(cx, cy, cz);
+
+				// Clearing never needs to create a chunk.
+				Chunk* chunk = material == VoxelMaterial_Air ? FindChunk(cc) : &chunks.FindOrAdd(cc);
+				if (!chunk)
+					continue;
+
+				const u32 localMin[3] = { Max(minX, cx) - cx, Max(minY, cy) - cy, Max(minZ, cz) - cz };
+				const u32 localMax[3] = { Min(maxX - cx, dim), Min(maxY - cy, dim), Min(maxZ - cz, dim) };
+
+				chunk->FillBox(localMin[0], localMin[1], localMin[2], localMax[0], localMax[1], localMax[2], material);
+				chunk->DirtyBorderNeighbours(localMin, localMax);
+				MarkOccupancyStale(cc, *chunk);
+			}
+		}
+	}
+}
+
+void VoxelWorld::ReplaceChunk(const ChunkCoord& cc, ChunkVoxels& voxels)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+	const u32 localMin[3] = { 0, 0, 0 };
+	const u32 localMax[3] = { dim, dim, dim };
+
+	Chunk& chunk = chunks.FindOrAdd(cc);
+	chunk.voxels = std::move(voxels);
+
+	chunk.MarkDirty();
+	chunk.DirtyBorderNeighbours(localMin, localMax);
+	MarkOccupancyStale(cc, chunk);
+}
+
+void VoxelWorld::AddColumn(VoxelColumn& column)
+{
+	constexpr u32 dim = (u32)Chunk::dim;
+
+	for (u32 i = 0; i < (u32)column.chunks.size(); i++)
+		ReplaceChunk(ChunkCoord(column.x, i * dim, column.z), column.chunks[i]);
+
+	column.chunks.clear();
+}
+
+bool VoxelWorld::RemoveChunk(const ChunkCoord& cc)
+{
+	Chunk* chunk = FindChunk(cc);
+	if (!chunk)
+		return false;
+
+	assert(!chunk->meshJobPending);
+
+	chunk->ReleaseMesh();
+
+	if (chunk->occupancyStale)
+	{
+		auto it = std::find_if(staleOccupancy.begin(), staleOccupancy.end(), [chunk](const StaleChunk& stale) { return stale.chunk == chunk; });
+		staleOccupancy.erase(it);
+	}
+
+	// The levels hold the occupancy as of the last update, which is what brickMask records.
+	if (chunk->brickMask != 0)
+		occupancy.SetChunkOccupied(cc.coord.chunkX, cc.coord.chunkY, cc.coord.chunkZ, false);
+
+	// The neighbours mesh their borders against this chunk, and will see air there once it's unlinked.
+	constexpr u32 dim = (u32)Chunk::dim;
+	const u32 localMin[3] = { 0, 0, 0 };
+	const u32 localMax[3] = { dim, dim, dim };
+	chunk->DirtyBorderNeighbours(localMin, localMax);
+
+	return chunks.Remove(cc);
+}
+
+void VoxelWorld::UpdateOccupancy()
+{
+	for (const StaleChunk& stale : staleOccupancy)
+	{
+		Chunk& chunk = *stale.chunk;
+		chunk.occupancyStale = false;
+
+		const bool wasOccupied = chunk.brickMask != 0;
+		chunk.brickMask = chunk.voxels.BrickMask();
+
+		const bool occupied = chunk.brickMask != 0;
+		if (occupied != wasOccupied)
+			occupancy.SetChunkOccupied(stale.coord.coord.chunkX, stale.coord.coord.chunkY, stale.coord.coord.chunkZ, occupied);
+	}
+
+	staleOccupancy.clear();
+}
+
+i32 VoxelWorld::EmptyCellShift(u32 x, u32 y, u32 z) const
+{
+	const u32 emptyLevel = occupancy.EmptyLevel(x >> VOXELS_PER_CHUNK, y >> VOXELS_PER_CHUNK, z >> VOXELS_PER_CHUNK);
+	if (emptyLevel != 0)
+		return (i32)(VOXELS_PER_CHUNK + 2 * (emptyLevel - 1));
+
+	// An occupied chunk always exists.
+	const Chunk& chunk = *FindChunk(ChunkCoord(x, y, z));
+
+	const u32 bx = x & VOXEL_MASK;
+	const u32 by = y & VOXEL_MASK;
+	const u32 bz = z & VOXEL_MASK;
+
+	constexpr u32 brickDim = (u32)Chunk::dim / 4;
+	const u32 brick = (bx / brickDim) | (by / brickDim) << 2 | (bz / brickDim) << 4;
+	if ((chunk.brickMask & (1ull << brick)) == 0)
+		return (i32)VOXELS_PER_CHUNK - 2;
+
+	return chunk.Empty(bx, by, bz) ? 0 : -1;
+}
+
+bool VoxelWorld::Raycast(float3 origin, float3 direction, float maxDistance, VoxelRaycastHit& hit)
+{
+	UpdateOccupancy();
+
+	const float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+	if (length == 0.0f)
+		return false;
+
+	// Work in voxel space, where voxel i covers i up to i + 1, in doubles so long rays stay exact enough to land on
+	// cell boundaries.
+	const double start[3] = { origin.x / VoxelSize + 0.5, origin.y / VoxelSize + 0.5, origin.z / VoxelSize + 0.5 };
+	const double dir[3] = { direction.x / length / VoxelSize, direction.y / length / VoxelSize, direction.z / length / VoxelSize };
+	const double tMax = maxDistance;
+
+	// Rays starting outside the world begin where they enter it.
+	double t = 0.0;
+	u32 enterAxis = 0;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		if (fabs(dir[axis]) > fabs(dir[enterAxis]))
+			enterAxis = axis;
+	}
+
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		if (start[axis] >= 0.0)
+			continue;
+
+		if (dir[axis] <= 0.0)
+			return false;
+
+		const double tEnter = -start[axis] / dir[axis];
+		if (tEnter > t)
+		{
+			t = tEnter;
+			enterAxis = axis;
+		}
+	}
+
+	if (t > tMax)
+		return false;
+
+	i64 voxel[3];
+	for (u32 axis = 0; axis < 3; axis++)
+		voxel[axis] = Max((i64)floor(start[axis] + dir[axis] * t), (i64)0);
+
+	FaceDir face = (FaceDir)(enterAxis * 2 + (dir[enterAxis] > 0.0 ? 0 : 1));
+
+	constexpr i64 worldSize = (i64)1 << 32;
+
+	for (;;)
+	{
+		if (voxel[0] >= worldSize || voxel[1] >= worldSize || voxel[2] >= worldSize)
+			return false;
+
+		const i32 shift = EmptyCellShift((u32)voxel[0], (u32)voxel[1], (u32)voxel[2]);
+		if (shift < 0)
+		{
+			hit.x = (u32)voxel[0];
+			hit.y = (u32)voxel[1];
+			hit.z = (u32)voxel[2];
+			hit.face = face;
+			hit.distance = (float)t;
+			return true;
+		}
+
+		// Step to where the ray leaves the empty cell.
+		const i64 cellSize = (i64)1 << shift;
+		i64 cellMin[3];
+		double tExit = INFINITY;
+		u32 exitAxis = 0;
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			cellMin[axis] = voxel[axis] & ~(cellSize - 1);
+			if (dir[axis] == 0.0)
+				continue;
+
+			const i64 boundary = dir[axis] > 0.0 ? cellMin[axis] + cellSize : cellMin[axis];
+			const double tAxis = (boundary - start[axis]) / dir[axis];
+			if (tAxis < tExit)
+			{
+				tExit = tAxis;
+				exitAxis = axis;
+			}
+		}
+
+		if (tExit > tMax)
+			return false;
+
+		t = Max(t, tExit);
+
+		// The exit axis moves into the next cell, the others stay within this one whatever the rounding.
+		for (u32 axis = 0; axis < 3; axis++)
+		{
+			if (axis == exitAxis)
+				voxel[axis] = dir[axis] > 0.0 ? cellMin[axis] + cellSize : cellMin[axis] - 1;
+			else
+				voxel[axis] = Clamp((i64)floor(start[axis] + dir[axis] * t), cellMin[axis], cellMin[axis] + cellSize - 1);
+		}
+
+		if (voxel[exitAxis] < 0)
+			return false;
+
+		face = (FaceDir)(exitAxis * 2 + (dir[exitAxis] > 0.0 ? 0 : 1));
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Chunk.h"
+#include "ChunkMap.h"
+#include "ChunkMesher.h"
+#include "VoxelCoord.h"
+#include "VoxelOccupancy.h"
+
+// One column of chunks generated away from the world, so columns can be filled on any thread at once and then added
+// with VoxelWorld::AddColumn.
+struct VoxelColumn
+{
+	// The voxel coordinate of the column's corner, a multiple of the chunk dimension.
+	u32 x = 0;
+	u32 z = 0;
+
+	// chunks[i] covers y from i * dim, up to the highest solid voxel.
+	std::vector<ChunkVoxels> chunks;
+};
+
+struct VoxelRaycastHit
+{
+	u32 x;
+	u32 y;
+	u32 z;
+
+	// The face of the voxel the ray entered through.
+	FaceDir face;
+
+	// Along the ray from its origin, in world units.
+	float distance;
+};
+
+struct VoxelWorld
+{
+	ChunkMap chunks;
+
+	// Which chunks hold solid voxels, with ChunkVoxels::BrickMask below it. Brought up to date by UpdateOccupancy.
+	VoxelOccupancy occupancy;
+
+	Chunk& GetChunk(VoxelCoord coord)
+	{
+		return chunks.FindOrAdd(ChunkCoord(coord));
+	}
+
+	// Unlike GetChunk this will not create the chunk if it does not exist.
+	Chunk* FindChunk(const ChunkCoord& cc)
+	{
+		return chunks.Find(cc);
+	}
+
+	const Chunk* FindChunk(const ChunkCoord& cc) const
+	{
+		return chunks.Find(cc);
+	}
+
+	void AddVoxel(VoxelCoord coord, VoxelMaterial material = VoxelMaterial_Stone)
+	{
+		Chunk& chunk = GetChunk(coord);
+		chunk.Set(coord.blockX, coord.blockY, coord.blockZ, material);
+		DirtyBorderNeighbours(chunk, coord);
+		MarkOccupancyStale(ChunkCoord(coord), chunk);
+	}
+
+	void AddVoxel(u32 x, u32 y, u32 z, VoxelMaterial material = VoxelMaterial_Stone)
+	{
+		AddVoxel(VoxelCoord{ x, y, z }, material);
+	}
+
+	void RemoveVoxel(VoxelCoord coord)
+	{
+		Chunk& chunk = GetChunk(coord);
+		chunk.Remove(coord.blockX, coord.blockY, coord.blockZ);
+		DirtyBorderNeighbours(chunk, coord);
+		MarkOccupancyStale(ChunkCoord(coord), chunk);
+	}
+
+	void RemoveVoxel(u32 x, u32 y, u32 z)
+	{
+		RemoveVoxel(VoxelCoord{ x, y, z });
+	}
+
+	// Bulk edits for generation. Each chunk touched is looked up once and written a row of voxels at a time.
+
+	// Sets every voxel from min up to but not including max.
+	void FillBox(u32 minX, u32 minY, u32 minZ, u32 maxX, u32 maxY, u32 maxZ, VoxelMaterial material = VoxelMaterial_Stone);
+
+	// Moves voxels into the chunk at cc, replacing whatever it held.
+	void ReplaceChunk(const ChunkCoord& cc, ChunkVoxels& voxels);
+
+	// Moves the column's chunks into the world, replacing the voxels of any chunks already there.
+	void AddColumn(VoxelColumn& column);
+
+	// Removes the chunk at cc, releasing its mesh and clearing it from the occupancy, and dirties the faces its
+	// neighbours share with it. The chunk must not have a mesh job pending. Must be called on the render thread.
+	bool RemoveChunk(const ChunkCoord& cc);
+
+	void MarkAllDirty();
+
+	// Queues the chunk's occupancy to be recomputed by the next UpdateOccupancy. Anything editing chunk voxels
+	// directly must call this.
+	void MarkOccupancyStale(const ChunkCoord& cc, Chunk& chunk)
+	{
+		if (chunk.occupancyStale)
+			return;
+
+		chunk.occupancyStale = true;
+		staleOccupancy.push_back({ cc, &chunk });
+	}
+
+	// Recomputes the brick masks of the chunks edited since the last update, and the occupancy levels of the ones
+	// that have gone from empty to solid or back.
+	void UpdateOccupancy();
+
+	// Finds the first solid voxel along the ray, stepping over empty bricks, chunks and groups of chunks in one go.
+	// A ray starting inside a solid voxel hits it at distance zero.
+	bool Raycast(float3 origin, float3 direction, float maxDistance, VoxelRaycastHit& hit);
+
+private:
+	struct StaleChunk
+	{
+		ChunkCoord coord;
+		Chunk* chunk;
+	};
+
+	std::vector<StaleChunk> staleOccupancy;
+
+	// Log2 of the size of the empty cell containing the voxel at x, y, z, aligned to that size. Returns -1 if the voxel
+	// is solid.
+	i32 EmptyCellShift(u32 x, u32 y, u32 z) const;
+
+	// A voxel on a chunk border changes which faces are visible in the adjacent chunk too.
+	static void DirtyBorderNeighbours(Chunk& chunk, VoxelCoord coord)
+	{
+		const u32 min[3] = { coord.blockX, coord.blockY, coord.blockZ };
+		const u32 max[3] = { min[0] + 1, min[1] + 1, min[2] + 1 };
+		chunk.DirtyBorderNeighbours(min, max);
+	}
+};